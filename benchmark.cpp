@@ -0,0 +1,645 @@
+#include "stream.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+
+/**
+ * Zestaw benchmarkow operacji strumienia. Dla kazdej kombinacji typu elementow, rozmiaru danych,
+ * selektywnosci filtra i liczby watkow kazda operacja wykonywana jest wielokrotnie, a wynikiem sa
+ * mediana, percentyle 95 i 99 czasu wykonania oraz przepustowosc. Dane wejsciowe przygotowywane sa
+ * przed pomiarem, a wyniki moga zostac zapisane w formacie JSON do porownywania miedzy wersjami.
+ *
+ * Parametry (wartosci oddzielane przecinkami):
+ *   --sizes=1000,100000   --selectivity=0.01,0.5,0.99   --threads=1,2,4   --types=int,double,string
+ *   --repetitions=15      --filter=fragment_nazwy        --json=plik.json (lub - dla stdout)
+ */
+
+#define KEY_SPACE 1024
+#define VALUE_RANGE 1000000
+
+struct benchmarkConfig {
+    std::vector<std::size_t> sizes{1000, 100000};
+    std::vector<double> selectivities{0.01, 0.5, 0.99};
+    std::vector<unsigned int> threads{1, 2, 4};
+    std::vector<std::string> types{"int", "double", "string"};
+    unsigned int repetitions = 15;
+    std::string filter;
+    std::string jsonPath;
+};
+
+struct benchmarkResult {
+    std::string name;
+    std::string type;
+    std::size_t size;
+    double selectivity;
+    unsigned int threads;
+    unsigned int repetitions;
+    double minNs;
+    double medianNs;
+    double p95Ns;
+    double p99Ns;
+    double meanNs;
+    double elementsPerSecond;
+};
+
+/**
+ * Dane jednego pomiaru, przygotowywane raz dla wszystkich powtorzen.
+ */
+template<class T>
+struct benchmarkInput {
+    std::vector<T> data;
+    T threshold;
+    double selectivity;
+    unsigned int threads;
+    std::vector<T> scratch;
+    stream::pipeline<T> compiled;
+    // pliki czytane przez zrodla plikowe, zapisywane przed pomiarem
+    std::string textPath;
+    std::string csvPath;
+    std::string binaryPath;
+    std::string columnarPath;
+};
+
+template<class T>
+struct benchmarkCase {
+    std::string name;
+    // czy wynik zalezy od selektywnosci filtra
+    bool selective;
+    // czy operacja korzysta z wielu watkow
+    bool threaded;
+    std::function<std::size_t(benchmarkInput<T> &)> run;
+};
+
+int makeValue(int *, std::uint32_t raw) {
+    return (int) raw;
+}
+
+double makeValue(double *, std::uint32_t raw) {
+    return raw + 0.5;
+}
+
+std::string makeValue(std::string *, std::uint32_t raw) {
+    // stala szerokosc z zerami wiodacymi zachowuje porzadek liczbowy przy porownaniu leksykograficznym
+    char text[16];
+    snprintf(text, sizeof(text), "%07u", raw);
+    return std::string(text);
+}
+
+std::size_t keyOf(int value) {
+    return (std::size_t) value % KEY_SPACE;
+}
+
+std::size_t keyOf(double value) {
+    return (std::size_t) value % KEY_SPACE;
+}
+
+std::size_t keyOf(const std::string &value) {
+    return std::hash<std::string>()(value) % KEY_SPACE;
+}
+
+// strumienie przyjmowane przez operacje join nie sa przez nie usuwane, podobnie jak strumienie po
+// operacjach terminalnych, wiec w benchmarku usuwane sa na koncu wyrazenia
+template<class T>
+std::unique_ptr<stream::stream<T>> owned(stream::stream<T> *source) {
+    return std::unique_ptr<stream::stream<T>>(source);
+}
+
+// strumien nad danymi wejsciowymi z filtrem o selektywnosci zadanej parametrem pomiaru
+template<class T>
+std::unique_ptr<stream::stream<T>> filtered(benchmarkInput<T> &in) {
+    T threshold = in.threshold;
+    std::unique_ptr<stream::stream<T>> result(stream::from(in.data));
+    result->filter([threshold](T v) { return v < threshold; });
+    return result;
+}
+
+// operacje wymagajace rekordow kopiowalnych bajt po bajcie dodawane sa tylko dla takich typow
+template<class T>
+void addBinaryCases(std::vector<benchmarkCase<T>> &cases, std::true_type) {
+    typedef benchmarkInput<T> input;
+    cases.push_back(benchmarkCase<T>{"filter.writeBinaryTo", true, false, [](input &in) {
+        std::ostringstream out;
+        filtered(in)->writeBinaryTo(out);
+        return out.str().size();
+    }});
+    cases.push_back(benchmarkCase<T>{"sort.external", false, false, [](input &in) {
+        std::size_t budget = std::max<std::size_t>(1024, in.data.size() * sizeof(T) / 4);
+        stream::stream<T> *sorted = owned(stream::from(in.data))->sort([](T a, T b) { return a < b; }, budget);
+        std::vector<T> *result = sorted->toVector();
+        std::size_t size = result->size();
+        delete (result);
+        delete (sorted);
+        return size;
+    }});
+}
+
+template<class T>
+void addBinaryCases(std::vector<benchmarkCase<T>> &, std::false_type) {
+}
+
+// zrodla generujace liczby oraz pliki kolumnowe i odwzorowane w pamieci dostepne sa tylko dla typow liczbowych
+template<class T>
+void addNumericCases(std::vector<benchmarkCase<T>> &cases, std::true_type) {
+    typedef benchmarkInput<T> input;
+    cases.push_back(benchmarkCase<T>{"range.toVector", false, false, [](input &in) {
+        std::vector<T> *result = owned(stream::range<T>(0, (T) in.data.size(), 1))->toVector();
+        std::size_t size = result->size();
+        delete (result);
+        return size;
+    }});
+    cases.push_back(benchmarkCase<T>{"generate.limit.toVector", false, false, [](input &in) {
+        T next = 0;
+        std::vector<T> *result = owned(stream::generate<T>([&next]() { return next++; }))
+                ->limit(in.data.size())->toVector();
+        std::size_t size = result->size();
+        delete (result);
+        return size;
+    }});
+    cases.push_back(benchmarkCase<T>{"iterate.limit.toVector", false, false, [](input &in) {
+        std::vector<T> *result = owned(stream::iterate<T>(0, [](T v) { return v + 1; }))
+                ->limit(in.data.size())->toVector();
+        std::size_t size = result->size();
+        delete (result);
+        return size;
+    }});
+    cases.push_back(benchmarkCase<T>{"fromFile.filter.toVector", true, false, [](input &in) {
+        T threshold = in.threshold;
+        std::vector<T> *result = owned(stream::fromFile<T>(in.columnarPath))
+                ->filter([threshold](T v) { return v < threshold; })->toVector();
+        std::size_t size = result->size();
+        delete (result);
+        return size;
+    }});
+    cases.push_back(benchmarkCase<T>{"filter.toFile", true, false, [](input &in) {
+        filtered(in)->toFile(in.columnarPath + ".out");
+        return in.data.size();
+    }});
+#if defined(__unix__) || defined(__APPLE__)
+    cases.push_back(benchmarkCase<T>{"mappedFile.filter.toVector", true, false, [](input &in) {
+        T threshold = in.threshold;
+        std::vector<T> *result = owned(new stream::stream<T>(new stream::mappedFileSource<T>(in.binaryPath)))
+                ->filter([threshold](T v) { return v < threshold; })->toVector();
+        std::size_t size = result->size();
+        delete (result);
+        return size;
+    }});
+#endif
+}
+
+template<class T>
+void addNumericCases(std::vector<benchmarkCase<T>> &, std::false_type) {
+}
+
+// pliki tekstowe dla zrodel lineSource i csvSource: wartosc w kazdej linii oraz wiersze "wartosc,klucz"
+template<class T>
+void prepareFiles(benchmarkInput<T> &in, const std::string &type) {
+    in.textPath = "stream_benchmark_" + type + ".txt";
+    in.csvPath = "stream_benchmark_" + type + ".csv";
+    std::ofstream text(in.textPath, std::ios::binary);
+    std::ofstream csv(in.csvPath, std::ios::binary);
+    for (const T &v : in.data) {
+        text << v << '\n';
+        csv << v << ',' << keyOf(v) << '\n';
+    }
+}
+
+template<class T>
+void prepareNumericFiles(benchmarkInput<T> &in, const std::string &type, std::true_type) {
+    in.binaryPath = "stream_benchmark_" + type + ".bin";
+    in.columnarPath = "stream_benchmark_" + type + ".col";
+    std::ofstream binary(in.binaryPath, std::ios::binary);
+    owned(stream::from(in.data))->writeBinaryTo(binary);
+    binary.close();
+    owned(stream::from(in.data))->toFile(in.columnarPath);
+}
+
+template<class T>
+void prepareNumericFiles(benchmarkInput<T> &, const std::string &, std::false_type) {
+}
+
+template<class T>
+void removeFiles(benchmarkInput<T> &in) {
+    const std::string paths[] = {in.textPath, in.csvPath, in.binaryPath, in.columnarPath, in.columnarPath + ".out"};
+    for (const std::string &path : paths) {
+        if (!path.empty()) std::remove(path.c_str());
+    }
+}
+
+template<class T>
+std::vector<benchmarkCase<T>> makeCases() {
+    typedef benchmarkInput<T> input;
+    std::vector<benchmarkCase<T>> cases;
+    auto add = [&cases](std::string name, bool selective, bool threaded, std::function<std::size_t(input &)> run) {
+        cases.push_back(benchmarkCase<T>{name, selective, threaded, run});
+    };
+    auto less = [](T a, T b) { return a < b; };
+
+    add("filter.toVector", true, false, [](input &in) {
+        std::vector<T> *result = filtered(in)->toVector();
+        std::size_t size = result->size();
+        delete (result);
+        return size;
+    });
+    add("filter.toDeque", true, false, [](input &in) {
+        std::deque<T> *result = filtered(in)->toDeque();
+        std::size_t size = result->size();
+        delete (result);
+        return size;
+    });
+    add("filter.toList", true, false, [](input &in) {
+        std::list<T> *result = filtered(in)->toList();
+        std::size_t size = result->size();
+        delete (result);
+        return size;
+    });
+    add("filter.toForwardList", true, false, [](input &in) {
+        std::forward_list<T> *result = filtered(in)
+                ->toForwardList();
+        std::size_t size = (std::size_t) std::distance(result->begin(), result->end());
+        delete (result);
+        return size;
+    });
+    add("filter.collect", true, false, [](input &in) {
+        filtered(in)->collect(in.scratch);
+        return in.scratch.size();
+    });
+    add("filter.copyTo", true, false, [](input &in) {
+        in.scratch.resize(in.data.size());
+        auto end = filtered(in)->copyTo(in.scratch.begin());
+        return (std::size_t) (end - in.scratch.begin());
+    });
+    add("filter.map", true, false, [](input &in) {
+        stream::stream<std::size_t> *mapped = filtered(in)
+                ->template map<std::size_t>([](T v) { return keyOf(v); });
+        std::vector<std::size_t> *result = mapped->toVector();
+        std::size_t size = result->size();
+        delete (result);
+        delete (mapped);
+        return size;
+    });
+    add("reduce", false, false, [](input &in) {
+        T result = owned(stream::from(in.data))->reduce([](T a, T b) { return a < b ? b : a; });
+        return keyOf(result);
+    });
+    add("filter.foreach", true, false, [](input &in) {
+        std::size_t count = 0;
+        filtered(in)->foreach([&count](T) { ++count; });
+        return count;
+    });
+    add("filter.anyMatches", true, false, [](input &in) {
+        return (std::size_t) filtered(in)->anyMatches();
+    });
+    add("filter.allMatch", true, false, [](input &in) {
+        return (std::size_t) filtered(in)->allMatch();
+    });
+    add("filter.find", true, false, [](input &in) {
+        return keyOf(filtered(in)->find());
+    });
+    add("filter.peek.toVector", true, false, [](input &in) {
+        std::size_t seen = 0;
+        std::vector<T> *result = filtered(in)
+                ->peek([&seen](T) { ++seen; })->toVector();
+        delete (result);
+        return seen;
+    });
+    add("topK", false, false, [less](input &in) {
+        std::vector<T> *result = owned(stream::from(in.data))->topK(100, less);
+        std::size_t size = result->size();
+        delete (result);
+        return size;
+    });
+    add("bottomK", false, false, [less](input &in) {
+        std::vector<T> *result = owned(stream::from(in.data))->bottomK(100, less);
+        std::size_t size = result->size();
+        delete (result);
+        return size;
+    });
+    add("filter.sort", true, false, [less](input &in) {
+        stream::stream<T> *sorted = filtered(in)->sort(less);
+        std::vector<T> *result = sorted->toVector();
+        std::size_t size = result->size();
+        delete (result);
+        delete (sorted);
+        return size;
+    });
+    add("semiJoin", false, false, [](input &in) {
+        std::vector<T> *result = owned(stream::from(in.data))
+                ->template semiJoin<std::size_t>(owned(stream::range<std::size_t>(0, KEY_SPACE / 2, 1)).get(),
+                                                 [](T v) { return keyOf(v); })
+                ->toVector();
+        std::size_t size = result->size();
+        delete (result);
+        return size;
+    });
+    add("antiJoin", false, false, [](input &in) {
+        std::vector<T> *result = owned(stream::from(in.data))
+                ->template antiJoin<std::size_t>(owned(stream::range<std::size_t>(0, KEY_SPACE / 2, 1)).get(),
+                                                 [](T v) { return keyOf(v); })
+                ->toVector();
+        std::size_t size = result->size();
+        delete (result);
+        return size;
+    });
+    add("filter.join", true, false, [](input &in) {
+        std::unique_ptr<stream::stream<std::size_t>> keys(stream::range<std::size_t>(0, KEY_SPACE, 1));
+        stream::stream<T> *joined = filtered(in)->template join<std::size_t, std::size_t, T>(
+                keys.get(), [](T v) { return keyOf(v); }, [](std::size_t k) { return k; },
+                [](T v, std::size_t) { return v; });
+        std::vector<T> *result = joined->toVector();
+        std::size_t size = result->size();
+        delete (result);
+        delete (joined);
+        return size;
+    });
+    add("partitioningBy", true, false, [](input &in) {
+        T threshold = in.threshold;
+        std::pair<std::vector<T> *, std::vector<T> *> parts = owned(stream::from(in.data))
+                ->partitioningBy([threshold](T v) { return v < threshold; });
+        std::size_t size = parts.first->size();
+        delete (parts.first);
+        delete (parts.second);
+        return size;
+    });
+    add("sample", false, false, [](input &in) {
+        std::vector<T> *result = owned(stream::from(in.data))->sample(100, 7);
+        std::size_t size = result->size();
+        delete (result);
+        return size;
+    });
+    add("bernoulli.toVector", true, false, [](input &in) {
+        std::vector<T> *result = owned(stream::from(in.data))->bernoulli(in.selectivity, 7)->toVector();
+        std::size_t size = result->size();
+        delete (result);
+        return size;
+    });
+    add("limit.toVector", true, false, [](input &in) {
+        std::vector<T> *result = owned(stream::from(in.data))
+                ->limit((unsigned long long) (in.data.size() * in.selectivity))->toVector();
+        std::size_t size = result->size();
+        delete (result);
+        return size;
+    });
+    add("filter.writeTo", true, false, [](input &in) {
+        std::ostringstream out;
+        filtered(in)->writeTo(out, '\n');
+        return out.str().size();
+    });
+    add("filter.cache.twoTerminals", true, false, [](input &in) {
+        stream::stream<T> *cached = filtered(in).release()->cache();
+        bool any = cached->anyMatches();
+        std::vector<T> *result = cached->toVector();
+        std::size_t size = result->size() + any;
+        delete (result);
+        delete (cached);
+        return size;
+    });
+    add("pipeline.collect", true, false, [](input &in) {
+        in.compiled.collect(in.data, in.scratch);
+        return in.scratch.size();
+    });
+    add("filter.memoized", true, false, [](input &in) {
+        T threshold = in.threshold;
+        stream::memoizer<T, bool> memo([threshold](T v) { return v < threshold; }, 1 << 16);
+        std::vector<T> *result = owned(stream::from(in.data))->filter(&memo)->toVector();
+        std::size_t size = result->size();
+        delete (result);
+        return size;
+    });
+    add("filter.adaptive.toVector", true, false, [](input &in) {
+        T threshold = in.threshold;
+        // predykaty celowo w niekorzystnej kolejnosci: najpierw przepuszczajacy wszystko
+        std::vector<T> *result = owned(stream::from(in.data))->adaptive()
+                ->filter([](T v) { return keyOf(v) < KEY_SPACE; })
+                ->filter([threshold](T v) { return v < threshold; })->toVector();
+        std::size_t size = result->size();
+        delete (result);
+        return size;
+    });
+    add("parallel.filter.toVector", true, true, [](input &in) {
+        T threshold = in.threshold;
+        std::vector<std::size_t> sizes(in.threads);
+        std::vector<std::thread> workers;
+        for (unsigned int part = 0; part < in.threads; ++part) {
+            workers.push_back(std::thread([&in, &sizes, part, threshold]() {
+                std::vector<T> *result = owned(stream::from(in.data.begin(), in.data.end(), part, in.threads))
+                        ->filter([threshold](T v) { return v < threshold; })->toVector();
+                sizes[part] = result->size();
+                delete (result);
+            }));
+        }
+        std::size_t size = 0;
+        for (unsigned int part = 0; part < in.threads; ++part) {
+            workers[part].join();
+            size += sizes[part];
+        }
+        return size;
+    });
+    add("lineSource.foreach", false, false, [](input &in) {
+        std::size_t bytes = 0;
+        owned(new stream::stream<stream::stringView>(new stream::lineSource(in.textPath)))
+                ->foreach([&bytes](stream::stringView line) { bytes += line.size(); });
+        return bytes;
+    });
+    add("csvSource.asLong", false, false, [](input &in) {
+        std::size_t sum = 0;
+        owned(new stream::stream<stream::csvRecord>(
+                new stream::csvSource(new stream::lineSource(in.csvPath), ',')))
+                ->foreach([&sum](const stream::csvRecord &record) { sum += (std::size_t) record.asLong(1); });
+        return sum;
+    });
+    add("csvSource.projection.asLong", false, false, [](input &in) {
+        std::size_t sum = 0;
+        owned(new stream::stream<stream::csvRecord>(
+                new stream::csvSource(new stream::lineSource(in.csvPath), ',', std::vector<unsigned int>{1})))
+                ->foreach([&sum](const stream::csvRecord &record) { sum += (std::size_t) record.asLong(0); });
+        return sum;
+    });
+    add("queueSource.toVector", false, false, [](input &in) {
+        stream::boundedQueue<T> queue(1024, stream::BLOCKING_WAIT);
+        std::thread producer([&in, &queue]() {
+            for (const T &v : in.data) queue.push(v);
+            queue.close();
+        });
+        std::vector<T> *result = owned(new stream::stream<T>(new stream::queueSource<T>(&queue)))->toVector();
+        producer.join();
+        std::size_t size = result->size();
+        delete (result);
+        return size;
+    });
+    add("continuous.filter.subscribe", true, false, [](input &in) {
+        T threshold = in.threshold;
+        stream::boundedQueue<T> queue(1024, stream::BLOCKING_WAIT);
+        std::size_t count = 0;
+        stream::continuousStream<T> events(&queue, stream::BLOCK_PRODUCER);
+        events.filter([threshold](T v) { return v < threshold; });
+        events.subscribe([&count](T) { ++count; });
+        events.start();
+        for (const T &v : in.data) events.publish(v);
+        events.stop();
+        return count;
+    });
+    addBinaryCases(cases, std::is_trivially_copyable<T>());
+    addNumericCases(cases, std::is_arithmetic<T>());
+    return cases;
+}
+
+double percentile(const std::vector<double> &sorted, double p) {
+    std::size_t rank = (std::size_t) std::ceil(p * sorted.size());
+    return sorted[rank == 0 ? 0 : rank - 1];
+}
+
+// zapobiega usunieciu mierzonych operacji przez kompilator
+volatile std::size_t sink;
+
+template<class T>
+benchmarkResult measureCase(const benchmarkCase<T> &bench, benchmarkInput<T> &input, const std::string &type,
+                            unsigned int repetitions) {
+    std::vector<double> samples;
+    samples.reserve(repetitions);
+    // pierwsze wykonanie rozgrzewa pamiec podreczna i alokator i nie jest liczone
+    sink = bench.run(input);
+    for (unsigned int i = 0; i < repetitions; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        sink = bench.run(input);
+        auto stop = std::chrono::steady_clock::now();
+        samples.push_back((double) std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    benchmarkResult result;
+    result.name = bench.name;
+    result.type = type;
+    result.size = input.data.size();
+    result.selectivity = bench.selective ? input.selectivity : 1.0;
+    result.threads = bench.threaded ? input.threads : 1;
+    result.repetitions = repetitions;
+    result.minNs = samples.front();
+    result.medianNs = percentile(samples, 0.5);
+    result.p95Ns = percentile(samples, 0.95);
+    result.p99Ns = percentile(samples, 0.99);
+    double sum = 0;
+    for (double sample : samples) sum += sample;
+    result.meanNs = sum / samples.size();
+    result.elementsPerSecond = result.medianNs > 0 ? input.data.size() * 1e9 / result.medianNs : 0;
+    return result;
+}
+
+void printResult(const benchmarkResult &result) {
+    std::cout << std::left << std::setw(28) << result.name << std::setw(8) << result.type
+              << std::right << std::setw(10) << result.size << std::setw(7) << result.selectivity
+              << std::setw(4) << result.threads << std::fixed << std::setprecision(1)
+              << std::setw(12) << result.medianNs / 1e3 << std::setw(12) << result.p95Ns / 1e3
+              << std::setw(12) << result.p99Ns / 1e3 << std::setw(14)
+              << result.elementsPerSecond / 1e6 << std::defaultfloat << std::setprecision(6) << std::endl;
+}
+
+template<class T>
+void runType(const benchmarkConfig &config, const std::string &type, std::vector<benchmarkResult> &results) {
+    std::vector<benchmarkCase<T>> cases = makeCases<T>();
+    for (std::size_t size : config.sizes) {
+        std::mt19937 generator(42);
+        std::uniform_int_distribution<std::uint32_t> distribution(0, VALUE_RANGE - 1);
+        benchmarkInput<T> input;
+        input.data.reserve(size);
+        for (std::size_t i = 0; i < size; ++i) input.data.push_back(makeValue((T *) NULL, distribution(generator)));
+        prepareFiles(input, type);
+        prepareNumericFiles(input, type, std::is_arithmetic<T>());
+        for (std::size_t s = 0; s < config.selectivities.size(); ++s) {
+            double selectivity = config.selectivities[s];
+            input.selectivity = selectivity;
+            input.threshold = makeValue((T *) NULL, (std::uint32_t) (selectivity * VALUE_RANGE));
+            T threshold = input.threshold;
+            input.compiled = stream::pipeline<T>();
+            input.compiled.filter([threshold](const T &v) { return v < threshold; });
+            for (std::size_t t = 0; t < config.threads.size(); ++t) {
+                input.threads = config.threads[t];
+                for (const benchmarkCase<T> &bench : cases) {
+                    if (!config.filter.empty() && bench.name.find(config.filter) == std::string::npos) continue;
+                    // operacje niezalezne od selektywnosci lub liczby watkow mierzone sa tylko raz
+                    if (!bench.selective && s > 0) continue;
+                    if (!bench.threaded && t > 0) continue;
+                    results.push_back(measureCase(bench, input, type, config.repetitions));
+                    printResult(results.back());
+                }
+            }
+        }
+        removeFiles(input);
+    }
+}
+
+void writeJson(std::ostream &out, const std::vector<benchmarkResult> &results) {
+    out.precision(12);
+    out << "[\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const benchmarkResult &r = results[i];
+        out << "  {\"name\": \"" << r.name << "\", \"type\": \"" << r.type << "\", \"size\": " << r.size
+            << ", \"selectivity\": " << r.selectivity << ", \"threads\": " << r.threads
+            << ", \"repetitions\": " << r.repetitions << ", \"min_ns\": " << r.minNs
+            << ", \"median_ns\": " << r.medianNs << ", \"p95_ns\": " << r.p95Ns << ", \"p99_ns\": " << r.p99Ns
+            << ", \"mean_ns\": " << r.meanNs << ", \"elements_per_second\": " << r.elementsPerSecond << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "]\n";
+}
+
+std::vector<std::string> splitList(const std::string &text) {
+    std::vector<std::string> items;
+    std::stringstream parts(text);
+    std::string item;
+    while (std::getline(parts, item, ',')) if (!item.empty()) items.push_back(item);
+    return items;
+}
+
+bool parseArguments(int argc, char **argv, benchmarkConfig &config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string argument(argv[i]);
+        std::size_t split = argument.find('=');
+        std::string name = argument.substr(0, split);
+        std::string value = split == std::string::npos ? "" : argument.substr(split + 1);
+        std::vector<std::string> items = splitList(value);
+        if (name == "--sizes") {
+            config.sizes.clear();
+            for (auto &item : items) config.sizes.push_back((std::size_t) std::strtoull(item.c_str(), NULL, 10));
+        } else if (name == "--selectivity") {
+            config.selectivities.clear();
+            for (auto &item : items) config.selectivities.push_back(std::strtod(item.c_str(), NULL));
+        } else if (name == "--threads") {
+            config.threads.clear();
+            for (auto &item : items) config.threads.push_back((unsigned int) std::strtoul(item.c_str(), NULL, 10));
+        } else if (name == "--types") {
+            config.types = items;
+        } else if (name == "--repetitions") {
+            config.repetitions = (unsigned int) std::max(1ul, std::strtoul(value.c_str(), NULL, 10));
+        } else if (name == "--filter") {
+            config.filter = value;
+        } else if (name == "--json") {
+            config.jsonPath = value;
+        } else {
+            std::cerr << "unknown argument: " << argument << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    benchmarkConfig config;
+    if (!parseArguments(argc, argv, config)) return 1;
+    std::cout << std::left << std::setw(28) << "operation" << std::setw(8) << "type" << std::right
+              << std::setw(10) << "size" << std::setw(7) << "sel" << std::setw(4) << "thr"
+              << std::setw(12) << "median us" << std::setw(12) << "p95 us" << std::setw(12) << "p99 us"
+              << std::setw(14) << "M elem/s" << std::endl;
+    std::vector<benchmarkResult> results;
+    for (const std::string &type : config.types) {
+        if (type == "int") runType<int>(config, type, results);
+        else if (type == "double") runType<double>(config, type, results);
+        else if (type == "string") runType<std::string>(config, type, results);
+        else std::cerr << "unknown type: " << type << std::endl;
+    }
+    if (config.jsonPath == "-") {
+        writeJson(std::cout, results);
+    } else if (!config.jsonPath.empty()) {
+        std::ofstream out(config.jsonPath);
+        writeJson(out, results);
+    }
+    return 0;
+}
@@ -7,18 +7,110 @@
 #include <functional>
 #include <forward_list>
 #include <list>
+#include <algorithm>
+#include <cstdint>
+#include <climits>
+#include <memory>
+#include <random>
+#include <cmath>
+#include <string>
+#include <type_traits>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cerrno>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <iterator>
+#include <array>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if __cplusplus >= 202002L
+#include <coroutine>
+#include <exception>
+#define STREAM_COROUTINES
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifndef STREAM_STATS_SAMPLING
+// co ktore wywolanie operacji mierzony jest czas jej wykonania w trybie STREAM_STATS
+#define STREAM_STATS_SAMPLING 64
+#endif
 
 namespace stream {
 
     class streamAlreadyConsumedException {
     };
 
+    class streamIOException {
+    };
+
+    class streamParseException {
+    };
+
     template<class T>
     class stream;
 
     template<class T, class... Args>
     class streamOperation;
 
+    template<class T>
+    class streamSource;
+
+    class outputBuffer;
+
+    template<class T>
+    class externalSortSource;
+
+    template<class K, class V>
+    class hashIndex;
+
+#ifdef STREAM_COROUTINES
+
+    template<class R>
+    class asyncResult;
+
+#endif
+
+    template<class K>
+    class membershipFilter;
+
+    template<class T>
+    class streamCache;
+
+    template<class K, class V>
+    class memoizer;
+
+    /**
+     * Statystyki jednej operacji strumienia zbierane po zdefiniowaniu STREAM_STATS.
+     */
+    struct stageStats {
+        // rodzaj operacji (filter, limit, semiJoin, ...)
+        std::string name;
+        // liczba elementow, ktore dotarly do operacji
+        unsigned long long in;
+        // liczba elementow przepuszczonych dalej
+        unsigned long long out;
+        // udzial przepuszczonych elementow, 1 gdy do operacji nie dotarl zaden element
+        double selectivity;
+        // laczny czas wykonania operacji w nanosekundach, szacowany na podstawie probek
+        double nanoseconds;
+    };
+
     template<class T>
     class stream {
 
@@ -67,6 +159,14 @@ namespace stream {
          */
         stream(T data[], int length);
 
+        /**
+         * Konstruktor tworzacy strumien z dowolnego zrodla danych, ktore udostepnia elementy
+         * fragmentami bez ich kopiowania do std::vector. Strumien przejmuje wlasnosc nad zrodlem.
+         *
+         * @param source zrodlo danych ktore zostanie opakowane strumieniem
+         */
+        stream(streamSource<T> *source);
+
         /**
          * Operacja nakladajaca na strumien filtr okreslony zadana funkcja.
          * Operacja nieterminalna
@@ -76,6 +176,28 @@ namespace stream {
          */
         stream<T> *filter(std::function<bool(T)> predicate);
 
+        /**
+         * Operacja nakladajaca na strumien filtr, ktory nie jest przestawiany przez adaptive i oddziela
+         * filtry dodane przed nim od filtrow dodanych po nim. Sluzy do warunkow, od ktorych zaleza
+         * kolejne filtry, np. sprawdzenia wskaznika przed filtrem, ktory go wyluskuje.
+         * Operacja nieterminalna
+         *
+         * @param predicate predykat okreslajacy warunek konieczny do znalezienia sie w wynikowym strumieniu
+         * @return strumien z zaaplikowana funkcja filtrujaca
+         */
+        stream<T> *guard(std::function<bool(T)> predicate);
+
+        /**
+         * Operacja nakladajaca na strumien filtr, ktorego wyniki dla powtarzajacych sie elementow
+         * sa zapamietywane, wiec kosztowny predykat wywolywany jest tylko dla nowych wartosci.
+         * Obiekt memoizer musi istniec az do zakonczenia przetwarzania strumienia.
+         * Operacja nieterminalna
+         *
+         * @param predicate predykat opakowany obiektem zapamietujacym wyniki
+         * @return strumien z zaaplikowana funkcja filtrujaca
+         */
+        stream<T> *filter(memoizer<T, bool> *predicate);
+
         /**
          * Operacja konwerujaca strumien, do typu wskazanego przez funkcje mapujaca, poprzez
          * zaaplikowanie jej do kazdego elementu strumienia.
@@ -88,6 +210,18 @@ namespace stream {
         template<class R>
         stream<R> *map(std::function<R(T)> mappingFunction);
 
+        /**
+         * Operacja mapowania, ktorej wyniki dla powtarzajacych sie elementow sa zapamietywane.
+         * Obiekt memoizer musi istniec az do zakonczenia operacji.
+         * Operacja terminalna
+         *
+         * @tparam R typ nowego strumienia
+         * @param mappingFunction funkcja mapujaca opakowana obiektem zapamietujacym wyniki
+         * @return nowy strumien z elementami bedacymi wynikiem funkcji mapujacej
+         */
+        template<class R>
+        stream<R> *map(memoizer<T, R> *mappingFunction);
+
         /**
          * Operacja redukcji strumienia. Wskazana funkcja bedzie wywolywana na
          * elementach strumienia, w postaci fun(poprzedni_wynik, aktualny_element),
@@ -131,19 +265,73 @@ namespace stream {
          * Operacja znajdujaca pierwszy element strumienia.
          * Operacja terminalna
          *
-         * @return znaleziony element, NULL dla pustego strumienia
+         * @return znaleziony element, wartosc domyslna typu T (NULL, 0) dla pustego strumienia
          */
         T find();
 
         /**
-         * Operacja uzytkowa, przechodzi strumien wypisujac jego zawartosc
-         * na standardowe wyjscie.
+         * Operacja uzytkowa, wypisuje na standardowe wyjscie elementy, ktore dotarly do tego miejsca
+         * strumienia, w trakcie jego przetwarzania przez operacje terminalna.
+         * Po zdefiniowaniu STREAM_NO_PEEK operacja nic nie robi.
          * Operacja nieterminalna
          *
          * @return ten sam strumien wejsciowy
          */
         stream<T> *peek();
 
+        /**
+         * Operacja wywolujaca zadana funkcje dla kazdego elementu, ktory dotarl do tego miejsca strumienia,
+         * w trakcie jego przetwarzania przez operacje terminalna, bez dodatkowego przejscia po danych.
+         * Po zdefiniowaniu STREAM_NO_PEEK operacja nie dodaje niczego do strumienia.
+         * Operacja nieterminalna
+         *
+         * @param observer funkcja wywolywana dla kazdego elementu
+         * @return strumien z zaaplikowanym obserwatorem
+         */
+        stream<T> *peek(std::function<void(T)> observer);
+
+        /**
+         * Operacja zapamietujaca wynik dotychczasowych operacji strumienia. Wynik wyliczany jest raz,
+         * przy pierwszej operacji terminalnej, i zapisywany w zwartym wektorze. Od tej chwili operacje
+         * terminalne nie zuzywaja strumienia i mozna je wywolywac wielokrotnie, a kazda z nich czyta
+         * zapamietany wynik zamiast ponownie przetwarzac zrodlo.
+         * Operacje dodane po cache stosowane sa przy kazdej kolejnej operacji terminalnej, a operacje
+         * stanowe (limit, bernoulli) zaczynaja wtedy od stanu poczatkowego.
+         * Operacja nieterminalna
+         *
+         * @return strumien z zapamietywanym wynikiem
+         */
+        stream<T> *cache();
+
+        /**
+         * Operacja tworzaca nowy, niezalezny i jednorazowy strumien nad wynikiem operacji tego strumienia.
+         * Wynik jest zapamietywany (jak w operacji cache) i wspoldzielony przez wszystkie odgalezienia,
+         * wiec kosztowne operacje wykonywane sa raz, niezaleznie od liczby odgalezien. Odgalezienia moga
+         * byc przetwarzane w osobnych watkach, wynik wyliczany jest wtedy przez pierwszy z nich.
+         * Operacja nieterminalna
+         *
+         * @return nowy strumien czytajacy zapamietany wynik
+         */
+        stream<T> *branch();
+
+        /**
+         * Operacja wlaczajaca adaptacyjna kolejnosc filtrow. Dla kolejnych sampleSize elementow co
+         * recheckInterval elementow strumienia mierzone sa selektywnosc i koszt kazdego filtra, po czym
+         * filtry ustawiane sa tak, aby minimalizowac oczekiwany koszt: najpierw tanie i odrzucajace
+         * wiekszosc elementow (rosnaco wedlug koszt / (1 - selektywnosc)). Zmieniana jest tylko kolejnosc
+         * sasiednich operacji filter, semiJoin, antiJoin i filtrow z memoizer, ktore nie moga miec efektow
+         * ubocznych; operacje stanowe (limit, bernoulli, peek) i guard pozostaja na swoich miejscach.
+         * Probkowane elementy przechodza przez filtry w biezacej kolejnosci, wiec mierzona jest selektywnosc
+         * filtra wsrod elementow przepuszczonych przez poprzednie. Przestawiane filtry musza byc okreslone
+         * dla kazdego elementu; filtr zalezny od wczesniejszego warunku nalezy dodac po operacji guard.
+         * Operacja nieterminalna
+         *
+         * @param sampleSize liczba elementow, na ktorych mierzone sa filtry
+         * @param recheckInterval co ile elementow pomiar jest powtarzany
+         * @return strumien z adaptacyjna kolejnoscia filtrow
+         */
+        stream<T> *adaptive(unsigned int sampleSize = 2048, unsigned long long recheckInterval = 1 << 18);
+
         /**
          * Operacja powrotu ze strumienia do std::vector. Aplikowane sa wszsytkie
          * operacje filter i zwracany nowy obiekt vectora.
@@ -180,25 +368,318 @@ namespace stream {
          */
         std::list<T> *toList();
 
-        ~stream();
+        /**
+         * Operacja zapisujaca elementy strumienia do istniejacego kontenera (np. std::vector, std::deque,
+         * std::list). Kontener jest czyszczony, ale zachowuje zaalokowana pamiec, wiec ten sam bufor
+         * moze byc uzywany wielokrotnie bez kolejnych alokacji.
+         * Operacja terminalna
+         *
+         * @tparam C typ kontenera z metodami clear i push_back
+         * @param container kontener docelowy
+         */
+        template<class C>
+        void collect(C &container);
+
+        /**
+         * Operacja zapisujaca elementy strumienia przez iterator wyjsciowy.
+         * Operacja terminalna
+         *
+         * @tparam O typ iteratora wyjsciowego
+         * @param output iterator wskazujacy miejsce zapisu pierwszego elementu
+         * @return iterator za ostatnim zapisanym elementem
+         */
+        template<class O>
+        O copyTo(O output);
+
+        /**
+         * Operacja wybierajaca k najwiekszych elementow strumienia wedlug zadanego komparatora.
+         * Strumien przegladany jest jednokrotnie razem z predykatami operacji filter,
+         * a w pamieci utrzymywany jest jedynie kopiec o rozmiarze k, bez sortowania calosci.
+         * Operacja terminalna
+         *
+         * @param k liczba elementow do wybrania
+         * @param comparator funkcja zwracajaca true gdy pierwszy argument jest mniejszy od drugiego
+         * @return std::vector zawierajacy co najwyzej k elementow posortowanych malejaco
+         */
+        std::vector<T> *topK(unsigned int k, std::function<bool(T, T)> comparator);
+
+        /**
+         * Operacja wybierajaca k najmniejszych elementow strumienia wedlug zadanego komparatora.
+         * Dziala analogicznie do operacji topK.
+         * Operacja terminalna
+         *
+         * @param k liczba elementow do wybrania
+         * @param comparator funkcja zwracajaca true gdy pierwszy argument jest mniejszy od drugiego
+         * @return std::vector zawierajacy co najwyzej k elementow posortowanych rosnaco
+         */
+        std::vector<T> *bottomK(unsigned int k, std::function<bool(T, T)> comparator);
+
+        /**
+         * Operacja laczenia (hash join) dwoch strumieni. Dla kazdej pary elementow o rownych kluczach
+         * do wynikowego strumienia trafia wynik funkcji laczacej. Tablica haszujaca budowana jest
+         * na mniejszym ze strumieni, a drugi przegladany jest razem ze swoimi predykatami filter.
+         * Operacja terminalna dla obu strumieni
+         *
+         * @tparam U typ elementow drugiego strumienia
+         * @tparam K typ klucza laczenia, wymaga std::hash<K> oraz operatora ==
+         * @tparam R typ nowego strumienia
+         * @param other strumien z ktorym laczony jest ten strumien
+         * @param leftKey funkcja wyznaczajaca klucz elementu tego strumienia
+         * @param rightKey funkcja wyznaczajaca klucz elementu drugiego strumienia
+         * @param combiner funkcja tworzaca element wynikowy z pary polaczonych elementow
+         * @return nowy strumien z polaczonymi elementami
+         */
+        template<class U, class K, class R>
+        stream<R> *join(stream<U> *other, std::function<K(T)> leftKey, std::function<K(U)> rightKey,
+                        std::function<R(T, U)> combiner);
+
+        /**
+         * Operacja sortujaca elementy strumienia w pamieci.
+         * Operacja terminalna
+         *
+         * @param comparator funkcja zwracajaca true gdy pierwszy argument jest mniejszy od drugiego
+         * @return nowy strumien z posortowanymi elementami
+         */
+        stream<T> *sort(std::function<bool(T, T)> comparator);
+
+        /**
+         * Operacja sortujaca elementy strumienia z ograniczeniem zuzycia pamieci. Gdy elementy nie mieszcza
+         * sie w zadanym budzecie, posortowane serie zapisywane sa do plikow tymczasowych, a wynikowy
+         * strumien leniwie scala je (k-way merge) buforowanym sekwencyjnym odczytem.
+         * Podobnie jak sort(comparator) zachowuje kolejnosc rownych elementow.
+         * Wymaga typu T kopiowalnego bajt po bajcie.
+         * Operacja terminalna
+         *
+         * @param comparator funkcja zwracajaca true gdy pierwszy argument jest mniejszy od drugiego
+         * @param memoryBudget przyblizony limit pamieci na elementy w bajtach
+         * @return nowy strumien z posortowanymi elementami
+         */
+        stream<T> *sort(std::function<bool(T, T)> comparator, std::size_t memoryBudget);
+
+        /**
+         * Operacja pozostawiajaca w strumieniu jedynie elementy, ktorych klucz wystepuje w strumieniu kluczy.
+         * Ze zbioru kluczy budowany jest blokowy filtr Blooma, ktory tanio odrzuca wiekszosc
+         * elementow spoza zbioru, zanim wykonane zostanie dokladne sprawdzenie w tablicy haszujacej.
+         * Operacja nieterminalna, terminalna dla strumienia kluczy
+         *
+         * @tparam K typ klucza, wymaga std::hash<K> oraz operatora ==
+         * @param keys strumien kluczy
+         * @param keyFunction funkcja wyznaczajaca klucz elementu strumienia
+         * @return strumien z zaaplikowanym filtrem
+         */
+        template<class K>
+        stream<T> *semiJoin(stream<K> *keys, std::function<K(T)> keyFunction);
+
+        /**
+         * Operacja odwrotna do semiJoin, pozostawia elementy, ktorych klucz nie wystepuje w strumieniu kluczy.
+         * Operacja nieterminalna, terminalna dla strumienia kluczy
+         *
+         * @tparam K typ klucza, wymaga std::hash<K> oraz operatora ==
+         * @param keys strumien kluczy
+         * @param keyFunction funkcja wyznaczajaca klucz elementu strumienia
+         * @return strumien z zaaplikowanym filtrem
+         */
+        template<class K>
+        stream<T> *antiJoin(stream<K> *keys, std::function<K(T)> keyFunction);
+
+        /**
+         * Operacja dzielaca strumien na dwie kolekcje w jednym przejsciu: elementy spelniajace
+         * zadany predykat oraz pozostale. Predykaty operacji filter oraz predykat podzialu sa
+         * wyliczane raz dla kazdego elementu, a wynikowe wektory alokowane sa z dokladnym rozmiarem.
+         * Operacja terminalna
+         *
+         * @param predicate predykat okreslajacy przynaleznosc do pierwszej kolekcji
+         * @return para std::vector, pierwszy z elementami spelniajacymi predykat, drugi z pozostalymi
+         */
+        std::pair<std::vector<T> *, std::vector<T> *> partitioningBy(std::function<bool(T)> predicate);
+
+        /**
+         * Operacja losujaca k elementow strumienia metoda probkowania rezerwuarowego (algorytm L).
+         * Kolejne pozycje do zastapienia w rezerwuarze wyznaczane sa z gory, wiec elementy
+         * pomiedzy nimi sa jedynie pomijane. Dla tego samego ziarna wynik jest powtarzalny.
+         * Operacja terminalna
+         *
+         * @param k rozmiar probki
+         * @param seed ziarno generatora liczb losowych
+         * @return std::vector zawierajacy co najwyzej k wylosowanych elementow
+         */
+        std::vector<T> *sample(unsigned int k, unsigned long long seed);
+
+        /**
+         * Operacja pozostawiajaca kazdy element strumienia niezaleznie z prawdopodobienstwem p.
+         * Zamiast losowania dla kazdego elementu losowana jest dlugosc przerwy do nastepnego
+         * wybranego elementu. Dla tego samego ziarna wynik jest powtarzalny.
+         * Operacja nieterminalna
+         *
+         * @param p prawdopodobienstwo pozostawienia elementu
+         * @param seed ziarno generatora liczb losowych
+         * @return strumien z zaaplikowanym probkowaniem
+         */
+        stream<T> *bernoulli(double p, unsigned long long seed);
+
+        /**
+         * Operacja ograniczajaca strumien do pierwszych n elementow, ktore dotarly do tej operacji.
+         * Po osiagnieciu limitu przegladanie zrodla jest przerywane, co pozwala uzywac
+         * nieskonczonych zrodel, takich jak generate i iterate.
+         * Operacja nieterminalna
+         *
+         * @param n maksymalna liczba elementow
+         * @return strumien z zaaplikowanym ograniczeniem
+         */
+        stream<T> *limit(unsigned long long n);
+
+        /**
+         * Operacja zapisujaca elementy strumienia w postaci tekstowej do strumienia wyjsciowego.
+         * Elementy formatowane sa do duzego bufora wielokrotnego uzytku i zapisywane duzymi blokami,
+         * liczby calkowite i zmiennoprzecinkowe bez uzycia std::ostream.
+         * Operacja terminalna
+         *
+         * @param out strumien wyjsciowy
+         * @param separator znak zapisywany po kazdym elemencie
+         */
+        void writeTo(std::ostream &out, char separator);
+
+        /**
+         * Operacja zapisujaca elementy strumienia w postaci binarnej (bajty kazdego rekordu),
+         * w formacie czytanym przez mappedFileSource.
+         * Operacja terminalna
+         *
+         * @param out strumien wyjsciowy, powinien byc otwarty w trybie binarnym
+         */
+        void writeBinaryTo(std::ostream &out);
+
+#if defined(__unix__) || defined(__APPLE__)
+
+        /**
+         * Operacja zapisujaca elementy strumienia w postaci tekstowej do deskryptora pliku.
+         * Operacja terminalna
+         *
+         * @param descriptor deskryptor otwartego do zapisu pliku
+         * @param separator znak zapisywany po kazdym elemencie
+         */
+        void writeTo(int descriptor, char separator);
+
+        /**
+         * Operacja zapisujaca elementy strumienia w postaci binarnej do deskryptora pliku.
+         * Operacja terminalna
+         *
+         * @param descriptor deskryptor otwartego do zapisu pliku
+         */
+        void writeBinaryTo(int descriptor);
+
+#endif
+
+#ifdef STREAM_COROUTINES
+
+        /**
+         * Operacja uruchamiajaca zadana operacje terminalna w osobnym watku, ktorej wynik mozna
+         * oczekiwac przez co_await, bez blokowania watku wywolujacej korutyny.
+         * Korutyna jest wznawiana w watku, ktory wykonal operacje terminalna. Dostepna od C++20.
+         *
+         * @param terminal funkcja wykonujaca operacje terminalna na tym strumieniu
+         * @return obiekt oczekiwany przez co_await, zwracajacy wynik operacji terminalnej
+         */
+        template<class F>
+        auto async(F terminal) -> asyncResult<decltype(terminal(this))>;
+
+#endif
+
+        /**
+         * Operacja zapisujaca elementy strumienia do pliku w kolumnowym formacie binarnym.
+         * Elementy zapisywane sa fragmentami po 65536, kazdy ze statystykami min/max i kodowaniem
+         * wybranym sposrod: bez kompresji, delta, ramka odniesienia z pakowaniem bitow oraz slownik.
+         * Plik mozna wczytac funkcja fromFile. Wymaga typu arytmetycznego T, dla rekordow
+         * kazda kolumne nalezy zapisac do osobnego pliku.
+         * Operacja terminalna
+         *
+         * @param path sciezka do tworzonego pliku
+         */
+        void toFile(const std::string &path);
+
+        /**
+         * Operacja zwracajaca statystyki kolejnych operacji filtrujacych strumienia (filter, limit, bernoulli,
+         * semiJoin, ...): liczbe elementow wejsciowych i przepuszczonych, selektywnosc oraz laczny czas
+         * wykonania, mierzony dla co STREAM_STATS_SAMPLING-tego elementu. Statystyki zbierane sa tylko po
+         * zdefiniowaniu STREAM_STATS, bez niego operacja zwraca pusty wektor, a strumien nie ponosi zadnych
+         * dodatkowych kosztow. Zwykle wywolywana po operacji terminalnej.
+         *
+         * @return statystyki operacji w kolejnosci ich dodania do strumienia
+         */
+        std::vector<stageStats> *stats();
+
+        virtual ~stream();
 
     protected:
 
         void checkConsumed(bool consume);
 
+        bool matches(T v);
+
+        long long knownSize();
+
+        template<class F>
+        void forEachElement(F consumer);
+
+        template<class F>
+        void traverse(F consumer);
+
+        void writeText(outputBuffer &buffer, char separator);
+
+        void writeBinary(outputBuffer &buffer);
+
+        std::vector<T> *selectK(unsigned int k, std::function<bool(T, T)> before);
+
         template<class R>
         std::vector<R> *toVector(std::function<R(T)> mappingFunction);
 
+        stream<T> *addOperation(std::function<bool(T)> predicate, const char *name, bool reorderable);
+
+        bool matchesInOrder(T v);
+
+        bool matchesAdaptive(T v);
+
+        void reorderOperations();
+
     private:
+        template<class U>
+        friend class stream;
+
         std::vector<streamOperation<bool(T)> *> *predicates;
         std::vector<T> *underlyingVector;
+        streamSource<T> *source;
         bool consumed;
+        bool limitReached;
+        // zapamietany wynik operacji poprzedzajacych cache, wspoldzielony z odgalezieniami
+        std::shared_ptr<streamCache<T>> cached;
+        // liczba probkowanych elementow w trybie adaptive, 0 gdy tryb jest wylaczony
+        unsigned int adaptiveSample = 0;
+        unsigned long long adaptiveInterval = 0;
+        unsigned long long adaptiveSeen = 0;
     };
 
     template<class T, class... Args>
     class streamOperation<T(Args...)> {
     public:
         std::function<T(Args ...)> *fun;
+        // czy operacja moze zostac przestawiona w trybie adaptive
+        bool reorderable = true;
+        // pomiary trybu adaptive z biezacego okna probkowania
+        unsigned long long sampledPassed = 0;
+        unsigned long long sampledCalls = 0;
+        unsigned long long sampledNanos = 0;
+        // flaga strumienia ustawiana przez limit, przepinana gdy operacja zmienia wlasciciela
+        std::shared_ptr<bool *> stopFlag;
+        // przywraca stan poczatkowy operacji stanowej przed kolejna operacja terminalna strumienia z cache()
+        std::function<void()> reset;
+#ifdef STREAM_STATS
+        const char *name = "filter";
+        // pozycja operacji w kolejnosci dodania, niezmieniana przez adaptive
+        std::size_t index = 0;
+        unsigned long long in = 0;
+        unsigned long long out = 0;
+        unsigned long long timedCalls = 0;
+        unsigned long long timedNanos = 0;
+#endif
 
         ~streamOperation() {
             delete (fun);
@@ -209,232 +690,3559 @@ namespace stream {
         }
     };
 
+    /**
+     * Zrodlo danych strumienia udostepniajace elementy kolejnymi ciaglymi fragmentami.
+     * Pozwala przegladac dane, ktore nie sa przechowywane w std::vector, bez ich kopiowania.
+     */
     template<class T>
-    stream<T>::stream(const std::vector<T> &data) {
-        this->underlyingVector = new std::vector<T>(data);
-        this->predicates = new std::vector<streamOperation<bool(T)> *>();
-        this->consumed = false;
-    }
+    class streamSource {
+    public:
+        /**
+         * Udostepnia kolejny fragment elementow zrodla. Wskazniki pozostaja wazne
+         * do nastepnego wywolania tej metody.
+         *
+         * @return false gdy zrodlo zostalo wyczerpane
+         */
+        virtual bool nextChunk(const T *&begin, const T *&end) = 0;
 
-    template<class T>
-    stream<T>::stream(std::vector<T> *data) {
-        this->underlyingVector = data;
-        this->predicates = new std::vector<streamOperation<bool(T)> *>();
-        this->consumed = false;
-    }
+        /**
+         * @return liczba elementow zrodla lub -1 gdy nie jest znana z gory
+         */
+        virtual long long size() {
+            return -1;
+        }
 
-    template<class T>
-    stream<T>::stream(const std::deque<T> &data) {
-        this->underlyingVector = new std::vector<T>(data.begin(), data.end());
-        this->predicates = new std::vector<streamOperation<bool(T)> *>();
-        this->consumed = false;
-    }
+        virtual ~streamSource() {
+        }
+    };
 
-    template<class T>
-    stream<T>::stream(const std::forward_list<T> &data) {
-        this->underlyingVector = new std::vector<T>(data.begin(), data.end());
-        this->predicates = new std::vector<streamOperation<bool(T)> *>();
-        this->consumed = false;
-    }
+    /**
+     * Niewlasciciel fragmentu tekstu (wskaznik i dlugosc), odpowiednik std::string_view dla C++11.
+     */
+    class stringView {
+    public:
+        stringView() : begin(NULL), length(0) {
+        }
 
-    template<class T>
-    stream<T>::stream(const std::list<T> &data) {
-        this->underlyingVector = new std::vector<T>(data.begin(), data.end());
-        this->predicates = new std::vector<streamOperation<bool(T)> *>();
-        this->consumed = false;
-    }
+        stringView(const char *data, std::size_t length) : begin(data), length(length) {
+        }
 
-    template<class T>
-    stream<T>::stream(T data[], int length) {
-        this->underlyingVector = new std::vector<T>(data, data + length);
-        this->predicates = new std::vector<streamOperation<bool(T)> *>();
-        this->consumed = false;
-    }
+        stringView(const std::string &text) : begin(text.data()), length(text.size()) {
+        }
 
-    template<class T>
-    stream<T> *stream<T>::filter(std::function<bool(T)> predicate) {
-        checkConsumed(false);
-        auto *op = new streamOperation<bool(T)>(&predicate);
-        predicates->push_back(op);
-        return this;
-    }
+        const char *data() const {
+            return begin;
+        }
 
-    template<class T>
-    T stream<T>::find() {
-        std::vector<T> *pVector = this->toVector();
-        return pVector->empty() ? NULL : pVector->front();
-    }
+        std::size_t size() const {
+            return length;
+        }
 
-    template<class T>
-    bool stream<T>::anyMatches() {
-        return !toVector()->empty();
-    }
+        bool empty() const {
+            return length == 0;
+        }
 
-    template<class T>
-    bool stream<T>::allMatch() {
-        unsigned int fullSize = underlyingVector->size();
-        return toVector()->size() == fullSize;
-    }
+        char operator[](std::size_t i) const {
+            return begin[i];
+        }
+
+        std::string str() const {
+            return std::string(begin, length);
+        }
+
+        bool operator==(const stringView &other) const {
+            return length == other.length && (length == 0 || std::memcmp(begin, other.begin, length) == 0);
+        }
+
+        bool operator!=(const stringView &other) const {
+            return !(*this == other);
+        }
+
+        bool operator<(const stringView &other) const {
+            int order = std::memcmp(begin, other.begin, std::min(length, other.length));
+            return order < 0 || (order == 0 && length < other.length);
+        }
+
+    private:
+        const char *begin;
+        std::size_t length;
+    };
+
+    inline std::ostream &operator<<(std::ostream &out, const stringView &text) {
+        return out.write(text.data(), text.size());
+    }
+
+    /**
+     * Zrodlo danych czytajace tekst linia po linii przez bufor wielokrotnego uzytku.
+     * Linie udostepniane sa jako stringView wskazujace do bufora, bez kopiowania, i pozostaja wazne
+     * tylko do odczytu kolejnego fragmentu, dlatego aby zachowac linie nalezy je zmapowac na std::string.
+     * Linie przekraczajace granice bufora sa przenoszone na jego poczatek, a bufor rosnie
+     * tylko wtedy, gdy pojedyncza linia jest dluzsza od niego. Znaki konca linii (\n, \r\n) sa pomijane.
+     */
+    class lineSource : public streamSource<stringView> {
+    public:
+        /**
+         * @param input strumien wejsciowy, nie jest przejmowany na wlasnosc
+         */
+        lineSource(std::istream &input) : input(&input), file(NULL) {
+            init();
+        }
+
+        /**
+         * @param path sciezka do pliku tekstowego
+         */
+        lineSource(const std::string &path) : input(NULL), file(new std::ifstream(path.c_str(), std::ios::binary)) {
+            if (!file->is_open()) {
+                delete (file);
+                throw new streamIOException();
+            }
+            this->input = file;
+            init();
+        }
+
+        bool nextChunk(const stringView *&begin, const stringView *&end) {
+            lines.clear();
+            for (;;) {
+                const char *position = &buffer[0] + start;
+                const char *stop = &buffer[0] + filled;
+                const char *newLine;
+                while ((newLine = (const char *) std::memchr(position, '\n', stop - position)) != NULL) {
+                    emit(position, newLine);
+                    position = newLine + 1;
+                }
+                this->start = position - &buffer[0];
+                if (!lines.empty()) break;
+                if (exhausted) {
+                    if (start == filled) return false;
+                    emit(position, stop);
+                    this->start = filled;
+                    break;
+                }
+                refill();
+            }
+            begin = &lines[0];
+            end = &lines[0] + lines.size();
+            return true;
+        }
+
+        ~lineSource() {
+            delete (file);
+        }
+
+    private:
+        static const std::size_t BUFFER_SIZE = 1 << 20;
+
+        std::istream *input;
+        std::ifstream *file;
+        std::vector<char> buffer;
+        std::vector<stringView> lines;
+        std::size_t start;
+        std::size_t filled;
+        bool exhausted;
+
+        void init() {
+            this->buffer.resize(BUFFER_SIZE);
+            this->start = 0;
+            this->filled = 0;
+            this->exhausted = false;
+        }
+
+        void emit(const char *from, const char *to) {
+            if (to != from && *(to - 1) == '\r') --to;
+            lines.push_back(stringView(from, to - from));
+        }
+
+        /**
+         * Przenosi niedokonczona linie na poczatek bufora i doczytuje za nia kolejne dane.
+         */
+        void refill() {
+            std::memmove(&buffer[0], &buffer[0] + start, filled - start);
+            this->filled -= start;
+            this->start = 0;
+            if (filled == buffer.size()) buffer.resize(buffer.size() * 2);
+            std::streamsize read = input->rdbuf()->sgetn(&buffer[0] + filled, buffer.size() - filled);
+            if (read <= 0) this->exhausted = true;
+            else this->filled += (std::size_t) read;
+        }
+    };
+
+    /**
+     * Zrodlo danych generujace ciag arytmetyczny od begin (wlacznie) do end (wylacznie) z krokiem step.
+     * Elementy wyliczane sa na zadanie do niewielkiego bufora, bez materializacji calego zakresu.
+     */
+    template<class T>
+    class rangeSource : public streamSource<T> {
+    public:
+        rangeSource(T begin, T end, T step) : current(begin), end(end), step(step) {
+            this->left = count(std::is_integral<T>());
+            this->buffer.reserve(CHUNK_SIZE);
+        }
+
+        bool nextChunk(const T *&begin, const T *&end) {
+            buffer.clear();
+            fill(std::is_integral<T>());
+            if (buffer.empty()) return false;
+            begin = buffer.data();
+            end = buffer.data() + buffer.size();
+            return true;
+        }
+
+        long long size() {
+            return left;
+        }
+
+    private:
+        static const std::size_t CHUNK_SIZE = 1024;
+
+        T current;
+        T end;
+        T step;
+        // liczba pozostalych elementow, -1 gdy nie jest znana (typy zmiennoprzecinkowe, krok 0)
+        long long left;
+        std::vector<T> buffer;
+
+        // dla typow calkowitych liczba elementow wyznaczana jest z gory, aby dodawanie kroku
+        // nie moglo przekroczyc zakresu typu
+        void fill(std::true_type) {
+            if (left < 0) {
+                while (buffer.size() < CHUNK_SIZE && current < this->end) buffer.push_back(current);
+                return;
+            }
+            while (buffer.size() < CHUNK_SIZE && left > 0) {
+                buffer.push_back(current);
+                if (--left > 0) current += step;
+            }
+        }
+
+        void fill(std::false_type) {
+            while (buffer.size() < CHUNK_SIZE && (step > 0 ? current < this->end : current > this->end)) {
+                buffer.push_back(current);
+                current += step;
+            }
+        }
+
+        long long count(std::true_type) {
+            unsigned long long distance;
+            unsigned long long stride;
+            if (step > 0 && current < end) {
+                distance = (unsigned long long) end - (unsigned long long) current;
+                stride = (unsigned long long) step;
+            } else if (step < 0 && current > end) {
+                distance = (unsigned long long) current - (unsigned long long) end;
+                stride = 0ULL - (unsigned long long) step;
+            } else if (step == 0 && current < end) {
+                return -1;
+            } else {
+                return 0;
+            }
+            unsigned long long result = (distance - 1) / stride + 1;
+            return result > (unsigned long long) LLONG_MAX ? LLONG_MAX : (long long) result;
+        }
+
+        long long count(std::false_type) {
+            return -1;
+        }
+    };
+
+    /**
+     * Nieskonczone zrodlo danych, ktorego kolejne elementy sa wynikami wywolan zadanej funkcji.
+     * Rozmiar kolejnych fragmentow rosnie od 1 do 256, wiec przy ograniczeniu strumienia operacja limit
+     * funkcja wywolywana jest co najwyzej okolo dwa razy czesciej niz to konieczne.
+     */
+    template<class T>
+    class generateSource : public streamSource<T> {
+    public:
+        generateSource(std::function<T()> generator) : generator(generator), chunkSize(1) {
+        }
+
+        bool nextChunk(const T *&begin, const T *&end) {
+            buffer.clear();
+            for (std::size_t i = 0; i < chunkSize; ++i) buffer.push_back(generator());
+            if (chunkSize < MAX_CHUNK_SIZE) this->chunkSize *= 2;
+            begin = buffer.data();
+            end = buffer.data() + buffer.size();
+            return true;
+        }
+
+    private:
+        static const std::size_t MAX_CHUNK_SIZE = 256;
+
+        std::function<T()> generator;
+        std::vector<T> buffer;
+        std::size_t chunkSize;
+    };
+
+    /**
+     * Nieskonczone zrodlo danych seed, next(seed), next(next(seed)), ...
+     * Fragmenty rosna tak samo jak w generateSource.
+     */
+    template<class T>
+    class iterateSource : public streamSource<T> {
+    public:
+        iterateSource(T seed, std::function<T(T)> next) : current(seed), next(next), chunkSize(1), started(false) {
+        }
+
+        bool nextChunk(const T *&begin, const T *&end) {
+            buffer.clear();
+            for (std::size_t i = 0; i < chunkSize; ++i) {
+                if (started) current = next(current);
+                this->started = true;
+                buffer.push_back(current);
+            }
+            if (chunkSize < MAX_CHUNK_SIZE) this->chunkSize *= 2;
+            begin = buffer.data();
+            end = buffer.data() + buffer.size();
+            return true;
+        }
+
+    private:
+        static const std::size_t MAX_CHUNK_SIZE = 256;
+
+        T current;
+        std::function<T(T)> next;
+        std::vector<T> buffer;
+        std::size_t chunkSize;
+        bool started;
+    };
+
+    /**
+     * Tworzy strumien elementow begin, begin + step, ... mniejszych od end (wiekszych dla ujemnego kroku).
+     */
+    template<class T>
+    stream<T> *range(T begin, T end, T step) {
+        return new stream<T>(new rangeSource<T>(begin, end, step));
+    }
+
+    /**
+     * Tworzy nieskonczony strumien wynikow kolejnych wywolan funkcji, zwykle ograniczany operacja limit.
+     */
+    template<class T>
+    stream<T> *generate(std::function<T()> generator) {
+        return new stream<T>(new generateSource<T>(generator));
+    }
+
+    /**
+     * Tworzy nieskonczony strumien seed, next(seed), next(next(seed)), ..., zwykle ograniczany operacja limit.
+     */
+    template<class T>
+    stream<T> *iterate(T seed, std::function<T(T)> next) {
+        return new stream<T>(new iterateSource<T>(seed, next));
+    }
+
+    /**
+     * Typ elementow strumienia tworzonego z zakresu iteratorow typu I.
+     */
+    template<class I>
+    struct iteratorValue {
+        typedef typename std::remove_cv<typename std::iterator_traits<I>::value_type>::type type;
+    };
+
+    /**
+     * Zrodlo danych nad ciagla tablica elementow. Caly zakres udostepniany jest jednym fragmentem,
+     * bez kopiowania. Tablica musi istniec az do zakonczenia przetwarzania strumienia.
+     */
+    template<class T>
+    class contiguousSource : public streamSource<T> {
+    public:
+        contiguousSource(const T *begin, const T *end) : begin(begin), end(end) {
+        }
+
+        bool nextChunk(const T *&begin, const T *&end) {
+            if (this->begin == this->end) return false;
+            begin = this->begin;
+            end = this->end;
+            this->begin = this->end;
+            return true;
+        }
+
+        long long size() {
+            return (long long) (end - begin);
+        }
+
+    private:
+        const T *begin;
+        const T *end;
+    };
+
+    /**
+     * Bufor wartosci logicznych w ciaglej tablicy. Zastepuje std::vector<bool>, ktory przechowuje bity
+     * i nie udostepnia wskaznika na elementy. Obsluguje tylko dopisywanie na koncu.
+     */
+    class boolBuffer {
+    public:
+        boolBuffer() : values(NULL), count(0), capacity(0) {
+        }
+
+        boolBuffer(const boolBuffer &) = delete;
+
+        boolBuffer &operator=(const boolBuffer &) = delete;
+
+        ~boolBuffer() {
+            delete[] (values);
+        }
+
+        void clear() {
+            this->count = 0;
+        }
+
+        bool empty() const {
+            return count == 0;
+        }
+
+        std::size_t size() const {
+            return count;
+        }
+
+        const bool *data() const {
+            return values;
+        }
+
+        bool *end() {
+            return values + count;
+        }
+
+        void push_back(bool value) {
+            if (count == capacity) grow();
+            values[count++] = value;
+        }
+
+        template<class I>
+        void insert(bool *, I first, I last) {
+            for (; first != last; ++first) push_back(*first);
+        }
+
+    private:
+        bool *values;
+        std::size_t count;
+        std::size_t capacity;
+
+        void grow() {
+            std::size_t size = capacity == 0 ? 16 : capacity * 2;
+            bool *grown = new bool[size];
+            std::copy(values, values + count, grown);
+            delete[] (values);
+            this->values = grown;
+            this->capacity = size;
+        }
+    };
+
+    /**
+     * Zrodlo danych nad dowolna para iteratorow (std::set, std::map, std::unordered_map, wlasne kontenery).
+     * Kontener nie jest kopiowany w calosci - elementy przepisywane sa partiami do niewielkiego bufora.
+     * Dla iteratorow swobodnego dostepu partie maja staly rozmiar, a liczba elementow znana jest z gory.
+     * Dla pozostalych iteratorow rozmiar partii rosnie od 1 do 1024, wiec przy operacji limit
+     * odczytywanych jest niewiele wiecej elementow niz to konieczne.
+     * Kontener musi istniec az do zakonczenia przetwarzania strumienia.
+     */
+    template<class I>
+    class iteratorSource : public streamSource<typename iteratorValue<I>::type> {
+    public:
+        typedef typename iteratorValue<I>::type T;
+
+        iteratorSource(I begin, I end) : current(begin), last(end), batchSize(1) {
+        }
+
+        bool nextChunk(const T *&begin, const T *&end) {
+            buffer.clear();
+            fill(typename std::iterator_traits<I>::iterator_category());
+            if (buffer.empty()) return false;
+            begin = buffer.data();
+            end = buffer.data() + buffer.size();
+            return true;
+        }
+
+        long long size() {
+            return remaining(typename std::iterator_traits<I>::iterator_category());
+        }
+
+    private:
+        static const std::size_t MAX_BATCH_SIZE = 1024;
+
+        I current;
+        I last;
+        typename std::conditional<std::is_same<T, bool>::value, boolBuffer, std::vector<T>>::type buffer;
+        std::size_t batchSize;
+
+        void fill(std::random_access_iterator_tag) {
+            I batchEnd = last - current > (long long) MAX_BATCH_SIZE ? current + MAX_BATCH_SIZE : last;
+            buffer.insert(buffer.end(), current, batchEnd);
+            this->current = batchEnd;
+        }
+
+        void fill(std::input_iterator_tag) {
+            for (std::size_t i = 0; i < batchSize && current != last; ++i, ++current) buffer.push_back(*current);
+            if (batchSize < MAX_BATCH_SIZE) this->batchSize *= 2;
+        }
+
+        long long remaining(std::random_access_iterator_tag) {
+            return (long long) (last - current);
+        }
+
+        long long remaining(std::input_iterator_tag) {
+            return -1;
+        }
+    };
+
+    /**
+     * Tworzy strumien z zakresu iteratorow bez kopiowania kontenera.
+     * Kontener musi istniec az do zakonczenia przetwarzania strumienia.
+     */
+    template<class I>
+    stream<typename iteratorValue<I>::type> *from(I begin, I end) {
+        typedef typename iteratorValue<I>::type T;
+        return new stream<T>(new iteratorSource<I>(begin, end));
+    }
+
+    /**
+     * Tworzy strumien z ciaglej tablicy; elementy czytane sa bezposrednio z tablicy.
+     */
+    template<class T>
+    stream<T> *from(const T *begin, const T *end) {
+        return new stream<T>(new contiguousSource<T>(begin, end));
+    }
+
+    template<class T>
+    stream<T> *from(T *begin, T *end) {
+        return new stream<T>(new contiguousSource<T>(begin, end));
+    }
+
+    /**
+     * Tworzy strumien z czesci part (od 0) z parts rozlacznych czesci zakresu iteratorow swobodnego dostepu.
+     * Czesci maja rowne rozmiary i moga byc przetwarzane niezaleznie przez osobne strumienie,
+     * np. w osobnych watkach.
+     */
+    template<class I>
+    stream<typename iteratorValue<I>::type> *from(I begin, I end, unsigned int part, unsigned int parts) {
+        static_assert(std::is_base_of<std::random_access_iterator_tag,
+                              typename std::iterator_traits<I>::iterator_category>::value,
+                      "podzial na czesci wymaga iteratorow swobodnego dostepu");
+        long long count = (long long) (end - begin);
+        return from(begin + count * part / parts, begin + count * (part + 1) / parts);
+    }
+
+    /**
+     * Tworzy strumien z dowolnego kontenera lub tablicy bez kopiowania.
+     * Kontener musi istniec az do zakonczenia przetwarzania strumienia.
+     */
+    template<class R>
+    auto from(const R &range) -> stream<typename iteratorValue<decltype(std::begin(range))>::type> * {
+        return from(std::begin(range), std::end(range));
+    }
+
+    // std::vector<bool> nie przechowuje elementow w ciaglej tablicy i jest czytany przez iteratory
+    template<class T>
+    typename std::enable_if<!std::is_same<T, bool>::value, stream<T> *>::type from(const std::vector<T> &range) {
+        return from(range.data(), range.data() + range.size());
+    }
+
+    template<class T, std::size_t N>
+    stream<T> *from(const std::array<T, N> &range) {
+        return from(range.data(), range.data() + N);
+    }
+
+#ifdef STREAM_COROUTINES
+
+    /**
+     * Korutyna generujaca kolejne elementy przez co_yield, zrodlo dla strumienia tworzonego
+     * funkcja fromGenerator. Dostepna od C++20.
+     */
+    template<class T>
+    class generator {
+    public:
+        struct promise_type {
+            const T *current = nullptr;
+            std::exception_ptr exception;
+
+            generator get_return_object() {
+                return generator(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+
+            std::suspend_always initial_suspend() noexcept {
+                return {};
+            }
+
+            std::suspend_always final_suspend() noexcept {
+                return {};
+            }
+
+            std::suspend_always yield_value(const T &value) noexcept {
+                current = std::addressof(value);
+                return {};
+            }
+
+            void return_void() {
+            }
+
+            void unhandled_exception() {
+                exception = std::current_exception();
+            }
+
+            /**
+             * Liczy alokacje ramek korutyn, co pozwala sprawdzic w testach wydajnosci,
+             * czy kompilator je pominal.
+             */
+            static void *operator new(std::size_t size) {
+                frameAllocations().fetch_add(1, std::memory_order_relaxed);
+                return ::operator new(size);
+            }
+
+            static void operator delete(void *frame) {
+                ::operator delete(frame);
+            }
+        };
+
+        generator(generator &&other) noexcept : handle(other.handle) {
+            other.handle = nullptr;
+        }
+
+        generator(const generator &) = delete;
+
+        generator &operator=(const generator &) = delete;
+
+        ~generator() {
+            if (handle) handle.destroy();
+        }
+
+        /**
+         * Wznawia korutyne do nastepnego co_yield.
+         *
+         * @return false gdy korutyna sie zakonczyla
+         */
+        bool next() {
+            handle.resume();
+            if (handle.promise().exception) std::rethrow_exception(handle.promise().exception);
+            return !handle.done();
+        }
+
+        const T &value() const {
+            return *handle.promise().current;
+        }
+
+        static std::atomic<unsigned long long> &frameAllocations() {
+            static std::atomic<unsigned long long> allocations(0);
+            return allocations;
+        }
+
+    private:
+        std::coroutine_handle<promise_type> handle;
+
+        explicit generator(std::coroutine_handle<promise_type> handle) : handle(handle) {
+        }
+    };
+
+    /**
+     * Zrodlo danych pobierajace elementy z korutyny generator. Fragmenty rosna tak samo jak
+     * w generateSource, wiec korutyna nie jest wznawiana duzo czesciej niz to konieczne.
+     */
+    template<class T>
+    class coroutineSource : public streamSource<T> {
+    public:
+        coroutineSource(generator<T> &&source) : source(std::move(source)), chunkSize(1), finished(false) {
+        }
+
+        bool nextChunk(const T *&begin, const T *&end) {
+            buffer.clear();
+            while (!finished && buffer.size() < chunkSize) {
+                if (source.next()) buffer.push_back(source.value());
+                else this->finished = true;
+            }
+            if (chunkSize < MAX_CHUNK_SIZE) this->chunkSize *= 2;
+            if (buffer.empty()) return false;
+            begin = buffer.data();
+            end = buffer.data() + buffer.size();
+            return true;
+        }
+
+    private:
+        static const std::size_t MAX_CHUNK_SIZE = 256;
+
+        generator<T> source;
+        std::vector<T> buffer;
+        std::size_t chunkSize;
+        bool finished;
+    };
+
+    /**
+     * Tworzy strumien z elementow zwracanych przez korutyne.
+     */
+    template<class T>
+    stream<T> *fromGenerator(generator<T> source) {
+        return new stream<T>(new coroutineSource<T>(std::move(source)));
+    }
+
+    /**
+     * Wynik operacji terminalnej oczekiwany przez co_await. Po zawieszeniu korutyny
+     * operacja wykonywana jest w nowym watku, ktory nastepnie wznawia korutyne.
+     */
+    template<class R>
+    class asyncResult {
+    public:
+        asyncResult(std::function<R()> work) : work(work) {
+        }
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> awaiting) {
+            std::thread([this, awaiting]() {
+                try {
+                    result = work();
+                } catch (...) {
+                    exception = std::current_exception();
+                }
+                awaiting.resume();
+            }).detach();
+        }
+
+        R await_resume() {
+            if (exception) std::rethrow_exception(exception);
+            return std::move(result);
+        }
+
+    private:
+        std::function<R()> work;
+        R result;
+        std::exception_ptr exception;
+    };
+
+    template<>
+    class asyncResult<void> {
+    public:
+        asyncResult(std::function<void()> work) : work(work) {
+        }
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> awaiting) {
+            std::thread([this, awaiting]() {
+                try {
+                    work();
+                } catch (...) {
+                    exception = std::current_exception();
+                }
+                awaiting.resume();
+            }).detach();
+        }
+
+        void await_resume() {
+            if (exception) std::rethrow_exception(exception);
+        }
+
+    private:
+        std::function<void()> work;
+        std::exception_ptr exception;
+    };
+
+#endif
+
+    /**
+     * Sposob oczekiwania na miejsce lub element w boundedQueue: aktywne oczekiwanie z oddawaniem
+     * procesora albo, po krotkim aktywnym oczekiwaniu, uspienie watku.
+     */
+    enum waitPolicy {
+        SPIN_WAIT, BLOCKING_WAIT
+    };
+
+    /**
+     * Ograniczona kolejka wielu producentow i wielu konsumentow bez blokad (algorytm D. Wjukowa).
+     * Kazda komorka bufora cyklicznego ma licznik sekwencji, wiec producenci i konsumenci
+     * rezerwuja komorki jedna operacja compare_exchange. Po wywolaniu close producenci nie moga
+     * juz dodawac elementow, a konsumenci odbieraja pozostale elementy i otrzymuja sygnal konca.
+     */
+    template<class T>
+    class boundedQueue {
+    public:
+        /**
+         * @param capacity pojemnosc kolejki, zaokraglana w gore do potegi dwojki
+         * @param policy sposob oczekiwania w metodach push i pop
+         */
+        boundedQueue(std::size_t capacity, waitPolicy policy)
+                : policy(policy), isClosed(false), activeProducers(0), waiters(0) {
+            std::size_t size = 2;
+            while (size < capacity) size <<= 1;
+            this->mask = size - 1;
+            this->cells = new cell[size];
+            for (std::size_t i = 0; i < size; ++i) cells[i].sequence.store(i, std::memory_order_relaxed);
+            this->enqueuePosition.store(0, std::memory_order_relaxed);
+            this->dequeuePosition.store(0, std::memory_order_relaxed);
+        }
+
+        ~boundedQueue() {
+            delete[] (cells);
+        }
+
+        /**
+         * @return false gdy kolejka jest pelna
+         */
+        bool tryPush(const T &value) {
+            std::size_t position = enqueuePosition.load(std::memory_order_relaxed);
+            cell *target;
+            for (;;) {
+                target = &cells[position & mask];
+                std::size_t sequence = target->sequence.load(std::memory_order_acquire);
+                std::ptrdiff_t difference = (std::ptrdiff_t) sequence - (std::ptrdiff_t) position;
+                if (difference == 0) {
+                    if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = enqueuePosition.load(std::memory_order_relaxed);
+                }
+            }
+            target->data = value;
+            target->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @return false gdy kolejka jest pusta
+         */
+        bool tryPop(T &value) {
+            std::size_t position = dequeuePosition.load(std::memory_order_relaxed);
+            cell *source;
+            for (;;) {
+                source = &cells[position & mask];
+                std::size_t sequence = source->sequence.load(std::memory_order_acquire);
+                std::ptrdiff_t difference = (std::ptrdiff_t) sequence - (std::ptrdiff_t) (position + 1);
+                if (difference == 0) {
+                    if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = dequeuePosition.load(std::memory_order_relaxed);
+                }
+            }
+            value = source->data;
+            source->sequence.store(position + mask + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * Dodaje element, czekajac na wolne miejsce.
+         *
+         * @return false gdy kolejka zostala zamknieta
+         */
+        bool push(const T &value) {
+            for (unsigned int attempt = 0;; ++attempt) {
+                int result = pushIfOpen(value);
+                if (result >= 0) return result == 1;
+                wait(attempt);
+            }
+        }
+
+        /**
+         * Dodaje element bez czekania na wolne miejsce.
+         *
+         * @return false gdy kolejka jest pelna lub zostala zamknieta
+         */
+        bool offer(const T &value) {
+            return pushIfOpen(value) == 1;
+        }
+
+        /**
+         * Pobiera element, czekajac na jego pojawienie sie.
+         *
+         * @return false gdy kolejka zostala zamknieta i oprozniona
+         */
+        bool pop(T &value) {
+            for (unsigned int attempt = 0;; ++attempt) {
+                if (tryPop(value)) {
+                    wakeUp();
+                    return true;
+                }
+                // elementy dodane przed zamknieciem musza zostac odebrane, rowniez te, ktorych producenci
+                // sprawdzili stan kolejki przed zamknieciem, ale jeszcze nie opublikowali elementu
+                if (isClosed.load()) {
+                    while (activeProducers.load() != 0) std::this_thread::yield();
+                    return tryPop(value);
+                }
+                wait(attempt);
+            }
+        }
+
+        /**
+         * Sygnalizuje koniec danych.
+         */
+        void close() {
+            isClosed.store(true);
+            std::lock_guard<std::mutex> lock(mutex);
+            condition.notify_all();
+        }
+
+        bool closed() const {
+            return isClosed.load(std::memory_order_acquire);
+        }
+
+    private:
+        static const unsigned int SPINS = 64;
+
+        struct cell {
+            std::atomic<std::size_t> sequence;
+            T data;
+        };
+
+        cell *cells;
+        std::size_t mask;
+        waitPolicy policy;
+        char padding0[64];
+        std::atomic<std::size_t> enqueuePosition;
+        char padding1[64];
+        std::atomic<std::size_t> dequeuePosition;
+        char padding2[64];
+        std::atomic<bool> isClosed;
+        // liczba producentow, ktorzy sprawdzili, ze kolejka jest otwarta, i jeszcze nie zakonczyli dodawania
+        std::atomic<int> activeProducers;
+        std::atomic<int> waiters;
+        std::mutex mutex;
+        std::condition_variable condition;
+
+        /**
+         * @return 1 gdy element dodano, 0 gdy kolejka zostala zamknieta, -1 gdy kolejka jest pelna
+         */
+        int pushIfOpen(const T &value) {
+            // sekwencyjnie spojne operacje gwarantuja, ze konsument, ktory zobaczyl zamkniecie,
+            // zobaczy tez tego producenta i zaczeka na opublikowanie jego elementu
+            activeProducers.fetch_add(1);
+            if (isClosed.load()) {
+                activeProducers.fetch_sub(1);
+                return 0;
+            }
+            bool pushed = tryPush(value);
+            activeProducers.fetch_sub(1);
+            if (!pushed) return -1;
+            wakeUp();
+            return 1;
+        }
+
+        void wait(unsigned int attempt) {
+            if (attempt < SPINS) return;
+            if (policy == SPIN_WAIT) {
+                std::this_thread::yield();
+                return;
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            waiters.fetch_add(1);
+            // oczekiwanie z limitem czasu zabezpiecza przed utrata powiadomienia
+            condition.wait_for(lock, std::chrono::milliseconds(1));
+            waiters.fetch_sub(1);
+        }
+
+        void wakeUp() {
+            if (waiters.load() == 0) return;
+            std::lock_guard<std::mutex> lock(mutex);
+            condition.notify_all();
+        }
+    };
+
+    /**
+     * Zrodlo danych odbierajace elementy z boundedQueue, do ktorej rownolegle dodaja je producenci.
+     * Pierwszy element fragmentu jest oczekiwany zgodnie z polityka kolejki, a kolejne sa dobierane
+     * bez czekania, wiec przetwarzanie nadaza za producentami i dziala na paczkach elementow.
+     * Zrodlo konczy sie, gdy kolejka zostanie zamknieta i oprozniona. Kolejka nie jest przejmowana na wlasnosc.
+     */
+    template<class T>
+    class queueSource : public streamSource<T> {
+    public:
+        queueSource(boundedQueue<T> *queue) : queue(queue) {
+            this->buffer.resize(CHUNK_SIZE);
+        }
+
+        bool nextChunk(const T *&begin, const T *&end) {
+            if (!queue->pop(buffer[0])) return false;
+            std::size_t count = 1;
+            while (count < CHUNK_SIZE && queue->tryPop(buffer[count])) ++count;
+            begin = buffer.data();
+            end = buffer.data() + count;
+            return true;
+        }
+
+    private:
+        static const std::size_t CHUNK_SIZE = 256;
+
+        boundedQueue<T> *queue;
+        std::vector<T> buffer;
+    };
+
+    /**
+     * Zrodlo danych zwracajace posortowane elementy w ramach zadanego budzetu pamieci.
+     * Elementy dodawane sa metoda add, a po wywolaniu finish zrodlo moze byc czytane.
+     * Serie przekraczajace budzet sortowane sa w pamieci i zapisywane do plikow tymczasowych,
+     * ktore na koniec sa scalane przy uzyciu kopca, z osobnym buforem odczytu dla kazdej serii.
+     * Bufor odczytu ma co najmniej 64 KB, wiec jednoczesnie scalanych jest tyle serii, ile takich
+     * buforow miesci sie w budzecie (co najmniej dwie); nadmiarowe serie sa wczesniej scalane
+     * w kilku przebiegach. Dla budzetu mniejszego niz trzy bufory limit pamieci jest przekraczany.
+     */
+    template<class T>
+    class externalSortSource : public streamSource<T> {
+        static_assert(std::is_trivially_copyable<T>::value, "spilled records must be trivially copyable");
+
+    public:
+        externalSortSource(std::function<bool(T, T)> comparator, std::size_t memoryBudget)
+                : comparator(comparator), memoryBudget(memoryBudget), count(0), position(0), merging(false) {
+            this->runCapacity = std::max<std::size_t>(memoryBudget / sizeof(T), 1);
+            // bez rezerwacji wektor rosnacy przez podwajanie moglby zajac dwukrotnosc budzetu
+            this->run.reserve(runCapacity);
+        }
+
+        void add(const T &value) {
+            if (run.size() == runCapacity) spill();
+            run.push_back(value);
+            ++count;
+        }
+
+        void finish() {
+            if (runs.empty()) {
+                sortRun();
+                return;
+            }
+            spill();
+            std::vector<T>().swap(run);
+            std::size_t fanIn = std::max<std::size_t>(memoryBudget / MIN_BLOCK_BYTES, 3) - 1;
+            while (runs.size() > fanIn) mergePass(fanIn);
+            openReaders(runs);
+            this->merging = true;
+        }
+
+        bool nextChunk(const T *&begin, const T *&end) {
+            if (!merging) {
+                if (position >= run.size()) return false;
+                begin = run.data();
+                end = run.data() + run.size();
+                this->position = run.size();
+                return true;
+            }
+            if (!fillOutput()) return false;
+            begin = output.data();
+            end = output.data() + output.size();
+            return true;
+        }
+
+        long long size() {
+            return (long long) count;
+        }
+
+        ~externalSortSource() {
+            for (auto it = runs.begin(); it != runs.end(); ++it) std::fclose(*it);
+        }
+
+    private:
+        static const std::size_t MIN_BLOCK_BYTES = 1 << 16;
+
+        struct runReader {
+            std::FILE *file;
+            std::vector<T> block;
+            std::size_t position;
+            std::size_t filled;
+        };
+
+        /**
+         * Porzadek kopca: na szczycie seria z najmniejszym biezacym elementem, przy rownych
+         * elementach seria wczesniejsza, co zachowuje kolejnosc rownych elementow.
+         */
+        struct runOrder {
+            externalSortSource<T> *source;
+
+            runOrder(externalSortSource<T> *source) : source(source) {
+            }
+
+            bool operator()(std::size_t a, std::size_t b) const {
+                const runReader &first = source->readers[a];
+                const runReader &second = source->readers[b];
+                if (source->comparator(second.block[second.position], first.block[first.position])) return true;
+                return b < a && !source->comparator(first.block[first.position], second.block[second.position]);
+            }
+        };
+
+        std::function<bool(T, T)> comparator;
+        std::size_t memoryBudget;
+        std::size_t runCapacity;
+        std::size_t count;
+        std::size_t position;
+        bool merging;
+        std::vector<T> run;
+        std::vector<std::FILE *> runs;
+        std::vector<runReader> readers;
+        std::vector<std::size_t> heap;
+        std::vector<T> output;
+
+        void sortRun() {
+            std::stable_sort(run.begin(), run.end(), comparator);
+        }
+
+        void spill() {
+            sortRun();
+            std::FILE *file = std::tmpfile();
+            if (file == NULL) throw new streamIOException();
+            runs.push_back(file);
+            if (std::fwrite(run.data(), sizeof(T), run.size(), file) != run.size()) throw new streamIOException();
+            run.clear();
+        }
+
+        /**
+         * Przygotowuje scalanie zadanych serii: bufory odczytu dziela budzet z buforem wyjsciowym.
+         */
+        void openReaders(const std::vector<std::FILE *> &files) {
+            std::size_t blockSize = std::max<std::size_t>(memoryBudget / sizeof(T) / (files.size() + 1),
+                                                          MIN_BLOCK_BYTES / sizeof(T) + 1);
+            readers.resize(files.size());
+            heap.clear();
+            for (std::size_t i = 0; i < files.size(); ++i) {
+                std::rewind(files[i]);
+                readers[i].file = files[i];
+                readers[i].block.resize(blockSize);
+                readers[i].position = 0;
+                readers[i].filled = 0;
+                if (refill(readers[i])) heap.push_back(i);
+            }
+            std::make_heap(heap.begin(), heap.end(), runOrder(this));
+            output.clear();
+            output.reserve(blockSize);
+        }
+
+        /**
+         * Wypelnia bufor wyjsciowy kolejnymi najmniejszymi elementami scalanych serii.
+         *
+         * @return false gdy wszystkie serie zostaly wyczerpane
+         */
+        bool fillOutput() {
+            output.clear();
+            while (!heap.empty() && output.size() < output.capacity()) {
+                std::pop_heap(heap.begin(), heap.end(), runOrder(this));
+                runReader &reader = readers[heap.back()];
+                output.push_back(reader.block[reader.position++]);
+                if (reader.position < reader.filled || refill(reader)) {
+                    std::push_heap(heap.begin(), heap.end(), runOrder(this));
+                } else {
+                    heap.pop_back();
+                }
+            }
+            return !output.empty();
+        }
+
+        /**
+         * Scala kolejne grupy fanIn sasiednich serii w pojedyncze serie, zachowujac ich kolejnosc,
+         * dzieki czemu rowne elementy pozostaja w kolejnosci dodania.
+         */
+        void mergePass(std::size_t fanIn) {
+            std::vector<std::FILE *> merged;
+            for (std::size_t first = 0; first < runs.size(); first += fanIn) {
+                std::size_t last = std::min(first + fanIn, runs.size());
+                if (last - first == 1) {
+                    merged.push_back(runs[first]);
+                    continue;
+                }
+                std::FILE *file = std::tmpfile();
+                if (file == NULL) throw new streamIOException();
+                merged.push_back(file);
+                openReaders(std::vector<std::FILE *>(runs.begin() + first, runs.begin() + last));
+                while (fillOutput()) {
+                    if (std::fwrite(output.data(), sizeof(T), output.size(), file) != output.size()) {
+                        throw new streamIOException();
+                    }
+                }
+                for (std::size_t i = first; i < last; ++i) std::fclose(runs[i]);
+            }
+            runs.swap(merged);
+        }
+
+        bool refill(runReader &reader) {
+            reader.position = 0;
+            reader.filled = std::fread(reader.block.data(), sizeof(T), reader.block.size(), reader.file);
+            if (reader.filled == 0 && std::ferror(reader.file)) throw new streamIOException();
+            return reader.filled > 0;
+        }
+    };
+
+    /**
+     * Parsuje liczbe calkowita zapisana dziesietnie, z opcjonalnym znakiem.
+     * Rzuca streamParseException dla niepoprawnego tekstu i wartosci spoza zakresu long long.
+     */
+    inline long long parseLong(stringView text) {
+        const char *it = text.data();
+        const char *end = it + text.size();
+        bool negative = it != end && *it == '-';
+        if (it != end && (*it == '-' || *it == '+')) ++it;
+        if (it == end) throw new streamParseException();
+        // najwieksza wartosc bezwzgledna: 2^63 dla liczb ujemnych, 2^63 - 1 dla dodatnich
+        unsigned long long limit = negative ? 9223372036854775808ULL : 9223372036854775807ULL;
+        unsigned long long value = 0;
+        for (; it != end; ++it) {
+            unsigned int digit = (unsigned int) (*it - '0');
+            if (digit > 9) throw new streamParseException();
+            if (value > (limit - digit) / 10) throw new streamParseException();
+            value = value * 10 + digit;
+        }
+        // negacja bez przepelnienia rowniez dla LLONG_MIN
+        return negative && value != 0 ? -(long long) (value - 1) - 1 : (long long) value;
+    }
+
+    /**
+     * Parsuje liczbe zmiennoprzecinkowa. Typowe wartosci (do 19 cyfr znaczacych i niewielki wykladnik)
+     * liczone sa dokladnie z mantysy calkowitej i potegi dziesieciu, pozostale przez std::strtod.
+     * Rzuca streamParseException dla niepoprawnego tekstu.
+     */
+    inline double parseDouble(stringView text) {
+        static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        const char *it = text.data();
+        const char *end = it + text.size();
+        bool negative = it != end && *it == '-';
+        if (it != end && (*it == '-' || *it == '+')) ++it;
+        unsigned long long mantissa = 0;
+        int digits = 0;
+        int exponent = 0;
+        bool any = false;
+        for (; it != end && (unsigned int) (*it - '0') <= 9; ++it, any = true) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*it - '0');
+                if (mantissa != 0) ++digits;
+            } else {
+                ++exponent;
+            }
+        }
+        if (it != end && *it == '.') {
+            for (++it; it != end && (unsigned int) (*it - '0') <= 9; ++it, any = true) {
+                if (digits < 19) {
+                    mantissa = mantissa * 10 + (*it - '0');
+                    if (mantissa != 0) ++digits;
+                    --exponent;
+                }
+            }
+        }
+        if (!any) throw new streamParseException();
+        if (it != end && (*it == 'e' || *it == 'E')) {
+            ++it;
+            bool negativeExponent = it != end && *it == '-';
+            if (it != end && (*it == '-' || *it == '+')) ++it;
+            if (it == end) throw new streamParseException();
+            int written = 0;
+            for (; it != end && (unsigned int) (*it - '0') <= 9; ++it) {
+                if (written < 100000) written = written * 10 + (*it - '0');
+            }
+            exponent += negativeExponent ? -written : written;
+        }
+        if (it != end) throw new streamParseException();
+        if (mantissa < (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+            double value = (double) mantissa;
+            value = exponent < 0 ? value / powers[-exponent] : value * powers[exponent];
+            return negative ? -value : value;
+        }
+        std::string copy = text.str();
+        return std::strtod(copy.c_str(), NULL);
+    }
+
+    /**
+     * Rekord tekstowego pliku z separatorami. Pola sa widokami do bufora zrodla, a konwersja
+     * do liczb wykonywana jest dopiero na zadanie, wiec nieuzywane kolumny nie sa konwertowane.
+     * Rekord jest wazny tylko do odczytu kolejnego fragmentu zrodla.
+     */
+    class csvRecord {
+    public:
+        csvRecord() : fields(NULL), count(0) {
+        }
+
+        csvRecord(const stringView *fields, std::size_t count) : fields(fields), count(count) {
+        }
+
+        std::size_t size() const {
+            return count;
+        }
+
+        stringView operator[](std::size_t i) const {
+            return i < count ? fields[i] : stringView();
+        }
+
+        long long asLong(std::size_t i) const {
+            return parseLong((*this)[i]);
+        }
+
+        double asDouble(std::size_t i) const {
+            return parseDouble((*this)[i]);
+        }
+
+    private:
+        const stringView *fields;
+        std::size_t count;
+    };
+
+    /**
+     * Zrodlo danych dzielace linie tekstu na pola wedlug separatora (CSV, TSV).
+     * Separatory wyszukiwane sa po 16 bajtow naraz instrukcjami SSE2, gdy sa dostepne.
+     * Opcjonalna projekcja ogranicza rekord do wskazanych kolumn, a dzielenie linii konczy sie
+     * na ostatniej potrzebnej kolumnie. Pola w cudzyslowach sa obslugiwane bez usuwania
+     * podwojonych cudzyslowow wewnatrz pola, nie moga tez zawierac znakow konca linii.
+     */
+    class csvSource : public streamSource<csvRecord> {
+    public:
+        /**
+         * @param lines zrodlo linii tekstu, przejmowane na wlasnosc
+         * @param delimiter znak separatora pol
+         */
+        csvSource(streamSource<stringView> *lines, char delimiter) : lines(lines), delimiter(delimiter) {
+            this->needed = (std::size_t) -1;
+        }
+
+        /**
+         * @param lines zrodlo linii tekstu, przejmowane na wlasnosc
+         * @param delimiter znak separatora pol
+         * @param columns numery kolumn (od 0), ktore w tej kolejnosci trafia do rekordu
+         */
+        csvSource(streamSource<stringView> *lines, char delimiter, const std::vector<unsigned int> &columns)
+                : lines(lines), delimiter(delimiter), columns(columns) {
+            this->needed = columns.empty() ? 0 : *std::max_element(columns.begin(), columns.end()) + 1;
+        }
+
+        bool nextChunk(const csvRecord *&begin, const csvRecord *&end) {
+            const stringView *first;
+            const stringView *last;
+            if (!lines->nextChunk(first, last)) return false;
+            fields.clear();
+            offsets.clear();
+            for (const stringView *line = first; line != last; ++line) {
+                offsets.push_back(fields.size());
+                if (columns.empty()) {
+                    split(*line, fields);
+                } else {
+                    scratch.clear();
+                    split(*line, scratch);
+                    for (auto it = columns.begin(); it != columns.end(); ++it) {
+                        fields.push_back(*it < scratch.size() ? scratch[*it] : stringView());
+                    }
+                }
+            }
+            offsets.push_back(fields.size());
+            records.clear();
+            for (std::size_t i = 0; i + 1 < offsets.size(); ++i) {
+                records.push_back(csvRecord(fields.data() + offsets[i], offsets[i + 1] - offsets[i]));
+            }
+            begin = records.data();
+            end = records.data() + records.size();
+            return true;
+        }
+
+        ~csvSource() {
+            delete (lines);
+        }
+
+    private:
+        streamSource<stringView> *lines;
+        char delimiter;
+        std::vector<unsigned int> columns;
+        std::size_t needed;
+        std::vector<stringView> fields;
+        std::vector<stringView> scratch;
+        std::vector<std::size_t> offsets;
+        std::vector<csvRecord> records;
+
+        void split(stringView line, std::vector<stringView> &out) {
+            const char *it = line.data();
+            const char *end = it + line.size();
+            if (line.size() > 0 && std::memchr(it, '"', line.size()) != NULL) {
+                splitQuoted(line, out);
+                return;
+            }
+            const char *fieldStart = it;
+            std::size_t column = 0;
+#ifdef __SSE2__
+            __m128i separators = _mm_set1_epi8(delimiter);
+            for (; end - it >= 16 && column < needed; it += 16) {
+                __m128i block = _mm_loadu_si128((const __m128i *) it);
+                unsigned int mask = (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(block, separators));
+                while (mask != 0 && column < needed) {
+                    const char *at = it + __builtin_ctz(mask);
+                    out.push_back(stringView(fieldStart, at - fieldStart));
+                    fieldStart = at + 1;
+                    ++column;
+                    mask &= mask - 1;
+                }
+            }
+#endif
+            for (; it != end && column < needed; ++it) {
+                if (*it != delimiter) continue;
+                out.push_back(stringView(fieldStart, it - fieldStart));
+                fieldStart = it + 1;
+                ++column;
+            }
+            if (column < needed) out.push_back(stringView(fieldStart, end - fieldStart));
+        }
+
+        void splitQuoted(stringView line, std::vector<stringView> &out) {
+            const char *it = line.data();
+            const char *end = it + line.size();
+            for (std::size_t column = 0; column < needed; ++column) {
+                const char *fieldStart = it;
+                const char *fieldEnd;
+                if (it != end && *it == '"') {
+                    fieldStart = ++it;
+                    while (it != end && !(*it == '"' && (it + 1 == end || *(it + 1) != '"'))) {
+                        it += *it == '"' ? 2 : 1;
+                    }
+                    fieldEnd = it;
+                    if (it != end) ++it;
+                    while (it != end && *it != delimiter) ++it;
+                } else {
+                    while (it != end && *it != delimiter) ++it;
+                    fieldEnd = it;
+                }
+                out.push_back(stringView(fieldStart, fieldEnd - fieldStart));
+                if (it == end) break;
+                ++it;
+            }
+        }
+    };
+
+    /**
+     * Bufor wyjsciowy operacji zapisu. Dane zbierane sa w buforze wielokrotnego uzytku
+     * i przekazywane do std::ostream lub deskryptora pliku duzymi blokami.
+     * Bledy zapisu zglaszane sa wyjatkiem streamIOException.
+     */
+    class outputBuffer {
+    public:
+        outputBuffer(std::ostream &out) : out(&out), descriptor(-1), used(0) {
+            this->buffer.resize(BUFFER_SIZE);
+        }
+
+        outputBuffer(int descriptor) : out(NULL), descriptor(descriptor), used(0) {
+            this->buffer.resize(BUFFER_SIZE);
+        }
+
+        void write(const char *data, std::size_t length) {
+            if (used + length > buffer.size()) {
+                flush();
+                if (length > buffer.size()) {
+                    emit(data, length);
+                    return;
+                }
+            }
+            std::memcpy(&buffer[used], data, length);
+            this->used += length;
+        }
+
+        void put(char c) {
+            if (used == buffer.size()) flush();
+            buffer[used++] = c;
+        }
+
+        /**
+         * Zwraca miejsce na co najmniej length bajtow, ktore nalezy zatwierdzic metoda commit.
+         */
+        char *reserve(std::size_t length) {
+            if (used + length > buffer.size()) flush();
+            return &buffer[used];
+        }
+
+        void commit(std::size_t length) {
+            this->used += length;
+        }
+
+        void flush() {
+            if (used == 0) return;
+            emit(&buffer[0], used);
+            this->used = 0;
+        }
+
+    private:
+        static const std::size_t BUFFER_SIZE = 1 << 20;
+
+        std::ostream *out;
+        int descriptor;
+        std::vector<char> buffer;
+        std::size_t used;
+
+        void emit(const char *data, std::size_t length) {
+            if (out != NULL) {
+                out->write(data, (std::streamsize) length);
+                if (out->fail()) throw new streamIOException();
+                return;
+            }
+#if defined(__unix__) || defined(__APPLE__)
+            while (length > 0) {
+                ssize_t written = ::write(descriptor, data, length);
+                if (written < 0 && errno == EINTR) continue;
+                if (written <= 0) throw new streamIOException();
+                data += written;
+                length -= (std::size_t) written;
+            }
+#endif
+        }
+    };
+
+    /**
+     * Zapisuje liczbe calkowita bez znaku od konca bufora (co najmniej 20 znakow), zwraca poczatek tekstu.
+     */
+    inline char *formatUnsigned(unsigned long long value, char *end) {
+        static const char pairs[] = "0001020304050607080910111213141516171819"
+                                    "2021222324252627282930313233343536373839"
+                                    "4041424344454647484950515253545556575859"
+                                    "6061626364656667686970717273747576777879"
+                                    "8081828384858687888990919293949596979899";
+        char *it = end;
+        while (value >= 100) {
+            unsigned int pair = (unsigned int) (value % 100) * 2;
+            value /= 100;
+            *--it = pairs[pair + 1];
+            *--it = pairs[pair];
+        }
+        if (value >= 10) {
+            *--it = pairs[value * 2 + 1];
+            *--it = pairs[value * 2];
+        } else {
+            *--it = (char) ('0' + value);
+        }
+        return it;
+    }
+
+    template<class T>
+    typename std::enable_if<std::is_integral<T>::value>::type formatValue(outputBuffer &buffer, T value) {
+        char text[24];
+        char *end = text + sizeof(text);
+        bool negative = value < 0;
+        unsigned long long magnitude = negative ? 0ULL - (unsigned long long) value : (unsigned long long) value;
+        char *begin = formatUnsigned(magnitude, end);
+        if (negative) *--begin = '-';
+        buffer.write(begin, end - begin);
+    }
+
+    /**
+     * Liczby zmiennoprzecinkowe zapisywane sa z dokladnoscia do 6 miejsc po przecinku, bez koncowych zer.
+     * Wartosci bardzo duze, bardzo male i nieskonczone formatowane sa przez snprintf("%g").
+     */
+    template<class T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type formatValue(outputBuffer &buffer, T value) {
+        double x = (double) value;
+        double magnitude = x < 0 ? -x : x;
+        if (!(magnitude < 1e12) || (magnitude != 0 && magnitude < 1e-4)) {
+            char *text = buffer.reserve(32);
+            buffer.commit((std::size_t) std::snprintf(text, 32, "%g", x));
+            return;
+        }
+        unsigned long long scaled = (unsigned long long) (magnitude * 1e6 + 0.5);
+        unsigned long long whole = scaled / 1000000;
+        unsigned int fraction = (unsigned int) (scaled % 1000000);
+        char text[40];
+        char *end = text + 24;
+        char *begin = formatUnsigned(whole, end);
+        if (x < 0 && scaled != 0) *--begin = '-';
+        if (fraction != 0) {
+            *end++ = '.';
+            for (unsigned int divisor = 100000; fraction != 0; divisor /= 10) {
+                *end++ = (char) ('0' + fraction / divisor);
+                fraction %= divisor;
+            }
+        }
+        buffer.write(begin, end - begin);
+    }
+
+    inline void formatValue(outputBuffer &buffer, char value) {
+        buffer.put(value);
+    }
+
+    inline void formatValue(outputBuffer &buffer, bool value) {
+        buffer.put(value ? '1' : '0');
+    }
+
+    inline void formatValue(outputBuffer &buffer, const std::string &value) {
+        buffer.write(value.data(), value.size());
+    }
+
+    inline void formatValue(outputBuffer &buffer, const stringView &value) {
+        buffer.write(value.data(), value.size());
+    }
+
+    inline void formatValue(outputBuffer &buffer, const char *value) {
+        buffer.write(value, std::strlen(value));
+    }
+
+    /**
+     * Pozostale typy formatowane sa operatorem <<, tak jak w operacji peek.
+     */
+    template<class T>
+    typename std::enable_if<!std::is_arithmetic<T>::value>::type formatValue(outputBuffer &buffer, const T &value) {
+        std::ostringstream text;
+        text << value;
+        std::string formatted = text.str();
+        buffer.write(formatted.data(), formatted.size());
+    }
+
+    /**
+     * Opis fragmentu pliku kolumnowego przechowywany w stopce pliku.
+     * Wartosci min, max oraz base zapisane sa jako bajty typu elementu.
+     */
+    struct columnarChunkInfo {
+        std::uint64_t offset;
+        std::uint64_t length;
+        std::uint32_t count;
+        std::uint8_t encoding;
+        std::uint8_t width;
+        std::uint16_t dictionarySize;
+        std::uint64_t min;
+        std::uint64_t max;
+        std::uint64_t base;
+    };
+
+    /**
+     * Wspolne elementy kolumnowego formatu plikow: naglowek, kodowania i pakowanie bitow.
+     * Uklad pliku: naglowek, zakodowane fragmenty, tablica columnarChunkInfo, liczba fragmentow,
+     * polozenie tablicy i znacznik konca. Liczby zapisywane sa w kolejnosci bajtow maszyny.
+     */
+    class columnarFormat {
+    public:
+        enum encoding {
+            PLAIN = 0, DELTA = 1, FRAME_OF_REFERENCE = 2, DICTIONARY = 3
+        };
+
+        static const std::uint32_t VERSION = 1;
+        static const std::size_t CHUNK_SIZE = 65536;
+        static const std::size_t MAX_DICTIONARY = 256;
+
+        static const char *magic() {
+            return "SCOL";
+        }
+
+        static unsigned int bitWidth(std::uint64_t value) {
+            unsigned int width = 0;
+            while (value != 0) {
+                ++width;
+                value >>= 1;
+            }
+            return width;
+        }
+
+        static std::size_t packedWords(std::size_t count, unsigned int width) {
+            return (count * width + 63) / 64;
+        }
+
+        static void pack(const std::vector<std::uint64_t> &values, unsigned int width, std::vector<std::uint64_t> &out) {
+            out.assign(packedWords(values.size(), width), 0);
+            if (width == 0) return;
+            std::size_t bit = 0;
+            for (auto it = values.begin(); it != values.end(); ++it, bit += width) {
+                out[bit / 64] |= (*it) << (bit % 64);
+                if (bit % 64 + width > 64) out[bit / 64 + 1] |= (*it) >> (64 - bit % 64);
+            }
+        }
+
+        static void unpack(const std::uint64_t *words, std::size_t count, unsigned int width, std::uint64_t *out) {
+            if (width == 0) {
+                std::fill(out, out + count, 0);
+                return;
+            }
+            std::uint64_t mask = width == 64 ? ~0ULL : (1ULL << width) - 1;
+            std::size_t bit = 0;
+            for (std::size_t i = 0; i < count; ++i, bit += width) {
+                std::uint64_t value = words[bit / 64] >> (bit % 64);
+                if (bit % 64 + width > 64) value |= words[bit / 64 + 1] << (64 - bit % 64);
+                out[i] = value & mask;
+            }
+        }
+
+        static std::uint64_t zigzag(std::uint64_t delta) {
+            return (delta << 1) ^ (std::uint64_t) ((std::int64_t) delta >> 63);
+        }
+
+        static std::uint64_t unzigzag(std::uint64_t value) {
+            return (value >> 1) ^ (0ULL - (value & 1));
+        }
+    };
+
+    /**
+     * Zapisuje elementy typu arytmetycznego T do pliku kolumnowego. Dla kazdego fragmentu
+     * wybierane jest kodowanie dajace najmniejszy rozmiar.
+     */
+    template<class T>
+    class columnarFileWriter {
+        static_assert(std::is_arithmetic<T>::value, "columnar files store arithmetic values");
+
+    public:
+        columnarFileWriter(const std::string &path) {
+            this->file = std::fopen(path.c_str(), "wb");
+            if (file == NULL) throw new streamIOException();
+            std::uint32_t header[2] = {columnarFormat::VERSION, (std::uint32_t) sizeof(T)};
+            write(columnarFormat::magic(), 4);
+            write(header, sizeof(header));
+            this->offset = 4 + sizeof(header);
+            this->values.reserve(columnarFormat::CHUNK_SIZE);
+        }
+
+        void add(const T &value) {
+            values.push_back(value);
+            if (values.size() == columnarFormat::CHUNK_SIZE) writeChunk();
+        }
+
+        void close() {
+            if (!values.empty()) writeChunk();
+            std::uint64_t footer[2] = {(std::uint64_t) chunks.size(), offset};
+            if (!chunks.empty()) write(chunks.data(), chunks.size() * sizeof(columnarChunkInfo));
+            write(footer, sizeof(footer));
+            write(columnarFormat::magic(), 4);
+            bool failed = std::fclose(file) != 0;
+            this->file = NULL;
+            if (failed) throw new streamIOException();
+        }
+
+        ~columnarFileWriter() {
+            if (file != NULL) std::fclose(file);
+        }
+
+    private:
+        std::FILE *file;
+        std::uint64_t offset;
+        std::vector<T> values;
+        std::vector<columnarChunkInfo> chunks;
+        std::vector<std::uint64_t> scratch;
+        std::vector<std::uint64_t> packed;
+
+        void write(const void *data, std::size_t length) {
+            if (std::fwrite(data, 1, length, file) != length) throw new streamIOException();
+        }
+
+        static std::uint64_t bitsOf(T value) {
+            std::uint64_t bits = 0;
+            std::memcpy(&bits, &value, sizeof(T));
+            return bits;
+        }
+
+        void writeChunk() {
+            columnarChunkInfo info;
+            std::memset(&info, 0, sizeof(info));
+            info.offset = offset;
+            info.count = (std::uint32_t) values.size();
+            T min = *std::min_element(values.begin(), values.end());
+            T max = *std::max_element(values.begin(), values.end());
+            info.min = bitsOf(min);
+            info.max = bitsOf(max);
+            std::size_t best = values.size() * sizeof(T);
+            info.encoding = columnarFormat::PLAIN;
+
+            // slownik, o ile fragment ma co najwyzej MAX_DICTIONARY roznych wartosci
+            std::unordered_map<std::uint64_t, std::uint16_t> dictionary;
+            std::vector<T> entries;
+            for (auto it = values.begin(); it != values.end() && entries.size() <= columnarFormat::MAX_DICTIONARY; ++it) {
+                if (dictionary.insert(std::make_pair(bitsOf(*it), (std::uint16_t) entries.size())).second) {
+                    entries.push_back(*it);
+                }
+            }
+            bool dictionaryFits = entries.size() <= columnarFormat::MAX_DICTIONARY;
+            unsigned int dictionaryWidth = columnarFormat::bitWidth(entries.size() - 1);
+            std::size_t dictionaryBytes = entries.size() * sizeof(T)
+                                          + columnarFormat::packedWords(values.size(), dictionaryWidth) * 8;
+            if (dictionaryFits && dictionaryBytes < best) {
+                best = dictionaryBytes;
+                info.encoding = columnarFormat::DICTIONARY;
+            }
+            unsigned int referenceWidth = 64;
+            unsigned int deltaWidth = 64;
+            if (std::is_integral<T>::value) {
+                referenceWidth = columnarFormat::bitWidth((std::uint64_t) max - (std::uint64_t) min);
+                std::uint64_t widest = 0;
+                for (std::size_t i = 1; i < values.size(); ++i) {
+                    widest |= columnarFormat::zigzag((std::uint64_t) values[i] - (std::uint64_t) values[i - 1]);
+                }
+                deltaWidth = columnarFormat::bitWidth(widest);
+                std::size_t referenceBytes = columnarFormat::packedWords(values.size(), referenceWidth) * 8;
+                std::size_t deltaBytes = columnarFormat::packedWords(values.size() - 1, deltaWidth) * 8;
+                if (referenceBytes < best) {
+                    best = referenceBytes;
+                    info.encoding = columnarFormat::FRAME_OF_REFERENCE;
+                }
+                if (deltaBytes < best) {
+                    best = deltaBytes;
+                    info.encoding = columnarFormat::DELTA;
+                }
+            }
+
+            scratch.clear();
+            switch (info.encoding) {
+                case columnarFormat::PLAIN:
+                    write(values.data(), values.size() * sizeof(T));
+                    break;
+                case columnarFormat::DICTIONARY:
+                    info.width = (std::uint8_t) dictionaryWidth;
+                    info.dictionarySize = (std::uint16_t) entries.size();
+                    for (auto it = values.begin(); it != values.end(); ++it) scratch.push_back(dictionary[bitsOf(*it)]);
+                    write(entries.data(), entries.size() * sizeof(T));
+                    break;
+                case columnarFormat::FRAME_OF_REFERENCE:
+                    info.width = (std::uint8_t) referenceWidth;
+                    info.base = info.min;
+                    for (auto it = values.begin(); it != values.end(); ++it) {
+                        scratch.push_back((std::uint64_t) *it - (std::uint64_t) min);
+                    }
+                    break;
+                case columnarFormat::DELTA:
+                    info.width = (std::uint8_t) deltaWidth;
+                    info.base = bitsOf(values[0]);
+                    for (std::size_t i = 1; i < values.size(); ++i) {
+                        scratch.push_back(columnarFormat::zigzag((std::uint64_t) values[i] - (std::uint64_t) values[i - 1]));
+                    }
+                    break;
+            }
+            if (info.encoding != columnarFormat::PLAIN) {
+                columnarFormat::pack(scratch, info.width, packed);
+                if (!packed.empty()) write(packed.data(), packed.size() * 8);
+            }
+            info.length = best;
+            this->offset += best;
+            chunks.push_back(info);
+            values.clear();
+        }
+    };
+
+    /**
+     * Zrodlo danych czytajace plik kolumnowy. Fragmenty, dla ktorych funkcja chunkFilter wywolana
+     * ze statystykami min i max zwraca false, sa pomijane bez odczytu i dekodowania.
+     */
+    template<class T>
+    class columnarFileSource : public streamSource<T> {
+        static_assert(std::is_arithmetic<T>::value, "columnar files store arithmetic values");
+
+    public:
+        columnarFileSource(const std::string &path) {
+            open(path);
+        }
+
+        /**
+         * @param path sciezka do pliku kolumnowego
+         * @param chunkFilter funkcja (min, max) zwracajaca false, gdy fragment na pewno nie zawiera
+         *        szukanych elementow
+         */
+        columnarFileSource(const std::string &path, std::function<bool(T, T)> chunkFilter) : chunkFilter(chunkFilter) {
+            open(path);
+        }
+
+        bool nextChunk(const T *&begin, const T *&end) {
+            while (current < chunks.size() && chunkFilter && !chunkFilter(valueOf(chunks[current].min),
+                                                                           valueOf(chunks[current].max))) {
+                ++current;
+            }
+            if (current >= chunks.size()) return false;
+            decode(chunks[current++]);
+            begin = values.data();
+            end = values.data() + values.size();
+            return true;
+        }
+
+        long long size() {
+            if (chunkFilter) return -1;
+            long long total = 0;
+            for (auto it = chunks.begin(); it != chunks.end(); ++it) total += it->count;
+            return total;
+        }
+
+        ~columnarFileSource() {
+            std::fclose(file);
+        }
+
+    private:
+        std::FILE *file;
+        std::function<bool(T, T)> chunkFilter;
+        std::vector<columnarChunkInfo> chunks;
+        std::size_t current;
+        std::vector<T> values;
+        std::vector<std::uint64_t> payload;
+        std::vector<std::uint64_t> unpacked;
+
+        static T valueOf(std::uint64_t bits) {
+            T value;
+            std::memcpy(&value, &bits, sizeof(T));
+            return value;
+        }
+
+        void fail() {
+            std::fclose(file);
+            throw new streamIOException();
+        }
+
+        void open(const std::string &path) {
+            this->current = 0;
+            this->file = std::fopen(path.c_str(), "rb");
+            if (file == NULL) throw new streamIOException();
+            char magic[4];
+            std::uint32_t header[2];
+            if (std::fread(magic, 1, 4, file) != 4 || std::memcmp(magic, columnarFormat::magic(), 4) != 0) fail();
+            if (std::fread(header, sizeof(header), 1, file) != 1) fail();
+            if (header[0] != columnarFormat::VERSION || header[1] != sizeof(T)) fail();
+            std::uint64_t footer[2];
+            if (std::fseek(file, -(long) (sizeof(footer) + 4), SEEK_END) != 0) fail();
+            if (std::fread(footer, sizeof(footer), 1, file) != 1) fail();
+            chunks.resize((std::size_t) footer[0]);
+            if (std::fseek(file, (long) footer[1], SEEK_SET) != 0) fail();
+            if (!chunks.empty() && std::fread(chunks.data(), sizeof(columnarChunkInfo), chunks.size(), file) != chunks.size()) {
+                fail();
+            }
+        }
+
+        void decode(const columnarChunkInfo &info) {
+            payload.resize((std::size_t) (info.length + 7) / 8);
+            if (std::fseek(file, (long) info.offset, SEEK_SET) != 0) throw new streamIOException();
+            if (info.length > 0 && std::fread(payload.data(), 1, (std::size_t) info.length, file) != info.length) {
+                throw new streamIOException();
+            }
+            values.resize(info.count);
+            const char *bytes = (const char *) payload.data();
+            switch (info.encoding) {
+                case columnarFormat::PLAIN:
+                    std::memcpy(values.data(), bytes, info.count * sizeof(T));
+                    break;
+                case columnarFormat::DICTIONARY: {
+                    std::vector<T> dictionary(info.dictionarySize);
+                    std::memcpy(dictionary.data(), bytes, info.dictionarySize * sizeof(T));
+                    // slowa z indeksami zaczynaja sie za slownikiem, ktory nie musi byc wyrownany do 8 bajtow
+                    std::size_t packedBytes = (std::size_t) info.length - info.dictionarySize * sizeof(T);
+                    std::vector<std::uint64_t> words(packedBytes / 8);
+                    // przy szerokosci 0 nie ma slow z indeksami, a words.data() moze byc NULL
+                    if (packedBytes != 0) std::memcpy(words.data(), bytes + info.dictionarySize * sizeof(T), packedBytes);
+                    unpacked.resize(info.count);
+                    columnarFormat::unpack(words.data(), info.count, info.width, unpacked.data());
+                    for (std::size_t i = 0; i < info.count; ++i) values[i] = dictionary[unpacked[i]];
+                    break;
+                }
+                case columnarFormat::FRAME_OF_REFERENCE: {
+                    unpacked.resize(info.count);
+                    columnarFormat::unpack(payload.data(), info.count, info.width, unpacked.data());
+                    std::uint64_t base = (std::uint64_t) valueOf(info.base);
+                    for (std::size_t i = 0; i < info.count; ++i) values[i] = (T) (base + unpacked[i]);
+                    break;
+                }
+                case columnarFormat::DELTA: {
+                    unpacked.resize(info.count);
+                    columnarFormat::unpack(payload.data(), info.count - 1, info.width, unpacked.data());
+                    std::uint64_t previous = (std::uint64_t) valueOf(info.base);
+                    values[0] = (T) previous;
+                    for (std::size_t i = 1; i < info.count; ++i) {
+                        previous += columnarFormat::unzigzag(unpacked[i - 1]);
+                        values[i] = (T) previous;
+                    }
+                    break;
+                }
+                default:
+                    throw new streamIOException();
+            }
+        }
+    };
+
+    /**
+     * Tworzy strumien z pliku zapisanego operacja toFile.
+     */
+    template<class T>
+    stream<T> *fromFile(const std::string &path) {
+        return new stream<T>(new columnarFileSource<T>(path));
+    }
+
+    /**
+     * Tworzy strumien z pliku zapisanego operacja toFile, pomijajac fragmenty, dla ktorych
+     * chunkFilter(min, max) zwraca false. Dokladne filtrowanie elementow nalezy nadal wykonac operacja filter.
+     */
+    template<class T>
+    stream<T> *fromFile(const std::string &path, std::function<bool(T, T)> chunkFilter) {
+        return new stream<T>(new columnarFileSource<T>(path, chunkFilter));
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+
+    /**
+     * Zrodlo danych odwzorowujace w pamieci (mmap) plik binarny z rekordami typu T.
+     * Rekordy czytane sa bezposrednio ze stron pliku, bez kopiowania go do pamieci procesu,
+     * a juz przetworzone fragmenty sa zwalniane, wiec plik moze byc wiekszy od pamieci RAM.
+     * Plik moze zostac podzielony na czesci o granicach wyrownanych do rozmiaru strony,
+     * ktore moga byc przetwarzane niezaleznie przez osobne strumienie.
+     */
+    template<class T>
+    class mappedFileSource : public streamSource<T> {
+        static_assert(std::is_trivially_copyable<T>::value, "mapped records must be trivially copyable");
+
+    public:
+        /**
+         * @param path sciezka do pliku z rekordami
+         */
+        mappedFileSource(const std::string &path) {
+            open(path, 0, 1);
+        }
+
+        /**
+         * @param path sciezka do pliku z rekordami
+         * @param part numer czesci pliku, od 0
+         * @param parts liczba czesci na ktore dzielony jest plik
+         */
+        mappedFileSource(const std::string &path, unsigned int part, unsigned int parts) {
+            open(path, part, parts);
+        }
+
+        bool nextChunk(const T *&begin, const T *&end) {
+            if (position >= records) return false;
+            if (position > 0) release(position);
+            std::size_t last = std::min(records, position + CHUNK_BYTES / sizeof(T));
+            begin = data + position;
+            end = data + last;
+            position = last;
+            return true;
+        }
+
+        long long size() {
+            return (long long) records;
+        }
+
+        ~mappedFileSource() {
+            if (mapping != NULL) munmap(mapping, mappedBytes);
+            if (descriptor >= 0) close(descriptor);
+        }
+
+    private:
+        static const std::size_t CHUNK_BYTES = 1 << 24;
+
+        int descriptor;
+        void *mapping;
+        std::size_t mappedBytes;
+        const T *data;
+        std::size_t records;
+        std::size_t position;
+        std::size_t released;
+
+        void open(const std::string &path, unsigned int part, unsigned int parts) {
+            this->mapping = NULL;
+            this->mappedBytes = 0;
+            this->data = NULL;
+            this->records = 0;
+            this->position = 0;
+            this->released = 0;
+            this->descriptor = ::open(path.c_str(), O_RDONLY);
+            if (descriptor < 0) throw new streamIOException();
+            struct stat info;
+            if (fstat(descriptor, &info) != 0) {
+                close(descriptor);
+                throw new streamIOException();
+            }
+            // granice czesci sa wielokrotnoscia zarowno rozmiaru strony jak i rozmiaru rekordu
+            std::size_t page = (std::size_t) sysconf(_SC_PAGESIZE);
+            std::size_t unit = page;
+            while (unit % sizeof(T) != 0) unit += page;
+            std::size_t units = ((std::size_t) info.st_size / sizeof(T) * sizeof(T) + unit - 1) / unit;
+            std::size_t fileBytes = (std::size_t) info.st_size / sizeof(T) * sizeof(T);
+            std::size_t from = std::min(fileBytes, units * part / parts * unit);
+            std::size_t to = std::min(fileBytes, units * (part + 1) / parts * unit);
+            if (to <= from) return;
+            this->mappedBytes = to - from;
+            this->mapping = mmap(NULL, mappedBytes, PROT_READ, MAP_PRIVATE, descriptor, (off_t) from);
+            if (mapping == MAP_FAILED) {
+                this->mapping = NULL;
+                close(descriptor);
+                throw new streamIOException();
+            }
+            madvise(mapping, mappedBytes, MADV_SEQUENTIAL);
+            this->data = (const T *) mapping;
+            this->records = mappedBytes / sizeof(T);
+        }
+
+        /**
+         * Zwalnia strony przed rekordem o zadanym indeksie, ktore nie beda juz czytane.
+         */
+        void release(std::size_t record) {
+            std::size_t page = (std::size_t) sysconf(_SC_PAGESIZE);
+            std::size_t bytes = record * sizeof(T) / page * page;
+            if (bytes <= released) return;
+            madvise((char *) mapping + released, bytes - released, MADV_DONTNEED);
+            this->released = bytes;
+        }
+    };
+
+#endif
+
+    /**
+     * Miesza bity wartosci skrotu, tak aby rowniez mlodsze bity byly dobrze rozlozone
+     * (std::hash dla typow calkowitych jest zwykle identycznoscia).
+     */
+    inline std::uint64_t mixHash(std::uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    /**
+     * Sposob wyboru wpisu usuwanego z pelnego zbioru tablicy memoizer: najdawniej uzyty
+     * albo najdawniej wstawiony.
+     */
+    enum memoEviction {
+        EVICT_LEAST_RECENTLY_USED, EVICT_OLDEST_INSERTED
+    };
+
+    /**
+     * Opakowanie kosztownej funkcji (predykatu lub mapowania) zapamietujace jej wyniki dla ostatnio
+     * widzianych argumentow. Wyniki przechowywane sa w tablicy o stalej pojemnosci, podzielonej na
+     * zbiory po 4 sasiednie wpisy, wiec wyszukiwanie czyta zwykle jedna linie pamieci podrecznej,
+     * a przy zapelnieniu zbioru usuwany jest wpis wskazany przez memoEviction.
+     * Tablica dzielona jest na niezalezne czesci z osobnymi blokadami, dzieki czemu z jednego obiektu
+     * moga korzystac strumienie przetwarzane w wielu watkach. Funkcja wywolywana jest poza blokada.
+     *
+     * @tparam K typ argumentu funkcji
+     * @tparam V typ wyniku funkcji
+     */
+    template<class K, class V>
+    class memoizer {
+    public:
+        /**
+         * @param function opakowywana funkcja
+         * @param capacity maksymalna liczba zapamietanych wynikow (zaokraglana w gore do potegi dwojki)
+         * @param eviction sposob wyboru usuwanego wpisu
+         * @param shards liczba niezaleznie blokowanych czesci tablicy (zaokraglana w gore do potegi dwojki)
+         */
+        memoizer(std::function<V(K)> function, std::size_t capacity = 4096,
+                 memoEviction eviction = EVICT_LEAST_RECENTLY_USED, unsigned int shards = 16)
+                : wrapped(function), eviction(eviction) {
+            std::size_t shardCount = 1;
+            while (shardCount < shards) shardCount <<= 1;
+            std::size_t setsPerShard = 1;
+            while (setsPerShard * WAYS * shardCount < capacity) setsPerShard <<= 1;
+            this->shardMask = shardCount - 1;
+            this->setMask = setsPerShard - 1;
+            this->parts = std::vector<shard>(shardCount);
+            for (auto &part : parts) part.slots.resize(setsPerShard * WAYS);
+        }
+
+        V operator()(const K &key) {
+            std::uint64_t h = mixHash(std::hash<K>()(key));
+            shard &part = parts[(h >> 40) & shardMask];
+            entry *set = NULL;
+            std::uint32_t tag = (std::uint32_t) (h >> 32) | 1u;
+            {
+                std::lock_guard<std::mutex> lock(part.mutex);
+                set = &part.slots[(h & setMask) * WAYS];
+                for (unsigned int i = 0; i < WAYS; ++i) {
+                    if (set[i].tag == tag && set[i].key == key) {
+                        ++part.hits;
+                        if (eviction == EVICT_LEAST_RECENTLY_USED) set[i].stamp = ++part.clock;
+                        return set[i].value;
+                    }
+                }
+                ++part.misses;
+            }
+            V value = wrapped(key);
+            std::lock_guard<std::mutex> lock(part.mutex);
+            entry *victim = set;
+            for (unsigned int i = 0; i < WAYS; ++i) {
+                // wynik mogl zostac w miedzyczasie wstawiony przez inny watek
+                if (set[i].tag == tag && set[i].key == key) return value;
+                if (set[i].stamp < victim->stamp) victim = &set[i];
+            }
+            victim->key = key;
+            victim->value = value;
+            victim->tag = tag;
+            victim->stamp = ++part.clock;
+            return value;
+        }
+
+        /**
+         * @return funkcja korzystajaca z tego obiektu, ktory musi istniec przez caly czas jej uzywania
+         */
+        std::function<V(K)> function() {
+            return [this](K key) -> V {
+                return (*this)(key);
+            };
+        }
+
+        /**
+         * @return liczba wywolan, dla ktorych wynik byl zapamietany
+         */
+        unsigned long long hits() {
+            unsigned long long result = 0;
+            for (auto &part : parts) {
+                std::lock_guard<std::mutex> lock(part.mutex);
+                result += part.hits;
+            }
+            return result;
+        }
+
+        /**
+         * @return liczba wywolan, dla ktorych funkcja musiala zostac wywolana
+         */
+        unsigned long long misses() {
+            unsigned long long result = 0;
+            for (auto &part : parts) {
+                std::lock_guard<std::mutex> lock(part.mutex);
+                result += part.misses;
+            }
+            return result;
+        }
+
+        /**
+         * @return udzial trafien we wszystkich wywolaniach, 0 gdy nie bylo wywolan
+         */
+        double hitRate() {
+            unsigned long long found = hits();
+            unsigned long long total = found + misses();
+            return total == 0 ? 0.0 : (double) found / (double) total;
+        }
+
+    private:
+        static const unsigned int WAYS = 4;
+
+        struct entry {
+            K key;
+            V value;
+            std::uint32_t tag = 0;
+            std::uint64_t stamp = 0;
+        };
+
+        struct shard {
+            std::mutex mutex;
+            std::vector<entry> slots;
+            std::uint64_t clock = 0;
+            unsigned long long hits = 0;
+            unsigned long long misses = 0;
+        };
+
+        std::function<V(K)> wrapped;
+        memoEviction eviction;
+        std::vector<shard> parts;
+        std::size_t shardMask;
+        std::size_t setMask;
+    };
+
+    /**
+     * Plaska tablica haszujaca z wieloma wartosciami na klucz, uzywana przez operacje join.
+     * Kubelki i lancuchy kolizji przechowywane sa w ciaglych tablicach indeksow,
+     * bez osobnej alokacji dla kazdego wpisu. Nie przejmuje wlasnosci nad wierszami.
+     */
+    template<class K, class V>
+    class hashIndex {
+    public:
+        hashIndex(const std::vector<V> *rows, std::function<K(V)> keyFunction) {
+            this->rows = rows;
+            std::size_t buckets = 1;
+            while (buckets < rows->size() * 2) buckets <<= 1;
+            this->mask = buckets - 1;
+            this->heads.assign(buckets, -1);
+            this->next.resize(rows->size());
+            this->keys.reserve(rows->size());
+            this->hashes.reserve(rows->size());
+            for (std::size_t i = 0; i < rows->size(); ++i) {
+                K key = keyFunction((*rows)[i]);
+                std::uint64_t h = mixHash(std::hash<K>()(key));
+                keys.push_back(key);
+                hashes.push_back(h);
+            }
+            // wstawianie od konca zachowuje kolejnosc wierszy o tym samym kluczu
+            for (std::size_t i = rows->size(); i-- > 0;) {
+                next[i] = heads[hashes[i] & mask];
+                heads[hashes[i] & mask] = (long long) i;
+            }
+        }
+
+        template<class F>
+        void probe(const K &key, F consumer) const {
+            std::uint64_t h = mixHash(std::hash<K>()(key));
+            for (long long i = heads[h & mask]; i != -1; i = next[i]) {
+                if (hashes[i] == h && keys[i] == key) consumer((*rows)[i]);
+            }
+        }
+
+        bool contains(const K &key, std::uint64_t h) const {
+            for (long long i = heads[h & mask]; i != -1; i = next[i]) {
+                if (hashes[i] == h && keys[i] == key) return true;
+            }
+            return false;
+        }
+
+    private:
+        const std::vector<V> *rows;
+        std::vector<K> keys;
+        std::vector<std::uint64_t> hashes;
+        std::vector<long long> heads;
+        std::vector<long long> next;
+        std::size_t mask;
+    };
+
+    /**
+     * Zwraca liczbe losowa z przedzialu otwartego (0, 1), bezpieczna jako argument logarytmu.
+     */
+    inline double openUnitRandom(std::mt19937_64 &random) {
+        return ((random() >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+    }
+
+    /**
+     * Zwraca liczbe elementow do pominiecia przed nastepnym sukcesem (rozklad geometryczny),
+     * gdzie logFailure to logarytm prawdopodobienstwa porazki.
+     */
+    inline unsigned long long geometricSkip(std::mt19937_64 &random, double logFailure) {
+        double skip = std::floor(std::log(openUnitRandom(random)) / logFailure);
+        return skip < 1e18 ? (unsigned long long) skip : 1000000000000000000ULL;
+    }
+
+    /**
+     * Blokowy filtr Blooma. Kazdy klucz ustawia po jednym bicie w kazdym z osmiu 32-bitowych slow
+     * jednego bloku, wiec sprawdzenie dotyka tylko jednego bloku pamieci, a petle
+     * po slowach bloku kompilator moze zwektoryzowac.
+     */
+    class blockedBloomFilter {
+    public:
+        blockedBloomFilter(std::size_t expectedElements) {
+            // 16 bitow na element daje prawdopodobienstwo falszywie pozytywnej odpowiedzi ponizej 0.5%
+            this->blocks = expectedElements * 16 / BLOCK_BITS + 1;
+            this->words.assign(blocks * WORDS, 0);
+        }
+
+        void insert(std::uint64_t h) {
+            std::uint32_t *block = &words[blockOf(h) * WORDS];
+            std::uint32_t mask[WORDS];
+            makeMask((std::uint32_t) h, mask);
+            for (int i = 0; i < WORDS; ++i) block[i] |= mask[i];
+        }
+
+        bool mayContain(std::uint64_t h) const {
+            const std::uint32_t *block = &words[blockOf(h) * WORDS];
+            std::uint32_t mask[WORDS];
+            makeMask((std::uint32_t) h, mask);
+            std::uint32_t missing = 0;
+            for (int i = 0; i < WORDS; ++i) missing |= ~block[i] & mask[i];
+            return missing == 0;
+        }
+
+    private:
+        static const int WORDS = 8;
+        static const int BLOCK_BITS = WORDS * 32;
+
+        std::vector<std::uint32_t> words;
+        std::uint64_t blocks;
+
+        std::uint64_t blockOf(std::uint64_t h) const {
+            return ((h >> 32) * blocks) >> 32;
+        }
+
+        static void makeMask(std::uint32_t key, std::uint32_t mask[WORDS]) {
+            static const std::uint32_t salt[WORDS] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                                                      0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+            for (int i = 0; i < WORDS; ++i) mask[i] = 1U << ((key * salt[i]) >> 27);
+        }
+    };
+
+    /**
+     * Zbior kluczy dla operacji semiJoin i antiJoin: filtr Blooma przed dokladnym sprawdzeniem.
+     * Przejmuje wlasnosc nad wektorem kluczy.
+     */
+    template<class K>
+    class membershipFilter {
+    public:
+        membershipFilter(std::vector<K> *keys)
+                : keys(keys), bloom(keys->size()), index(keys, [](K k) -> K { return k; }) {
+            for (auto it = keys->begin(); it != keys->end(); ++it) {
+                bloom.insert(mixHash(std::hash<K>()(*it)));
+            }
+        }
+
+        ~membershipFilter() {
+            delete (keys);
+        }
+
+        bool contains(const K &key) const {
+            std::uint64_t h = mixHash(std::hash<K>()(key));
+            return bloom.mayContain(h) && index.contains(key, h);
+        }
+
+    private:
+        std::vector<K> *keys;
+        blockedBloomFilter bloom;
+        hashIndex<K, K> index;
+    };
+
+    /**
+     * Wynik strumienia wyliczany przy pierwszym uzyciu i wspoldzielony przez strumienie, ktore go czytaja.
+     */
+    template<class T>
+    class streamCache {
+    public:
+        streamCache(stream<T> *upstream) : upstream(upstream), result(NULL) {
+        }
+
+        std::vector<T> *get() {
+            // odgalezienia moga czytac wynik z wielu watkow, wyliczany jest tylko raz
+            std::call_once(computed, [this]() {
+                this->result = upstream->toVector();
+                result->shrink_to_fit();
+                delete (upstream);
+                this->upstream = NULL;
+            });
+            return result;
+        }
+
+        ~streamCache() {
+            delete (upstream);
+            delete (result);
+        }
+
+    private:
+        stream<T> *upstream;
+        std::vector<T> *result;
+        std::once_flag computed;
+    };
+
+    /**
+     * Zrodlo danych czytajace zapamietany wynik strumienia, wyliczany dopiero przy pierwszym odczycie.
+     */
+    template<class T>
+    class cacheSource : public streamSource<T> {
+    public:
+        cacheSource(std::shared_ptr<streamCache<T>> cached) : cached(cached), done(false) {
+        }
+
+        bool nextChunk(const T *&begin, const T *&end) {
+            std::vector<T> *result = cached->get();
+            if (done || result->empty()) return false;
+            this->done = true;
+            begin = result->data();
+            end = result->data() + result->size();
+            return true;
+        }
+
+        long long size() {
+            return done ? 0 : (long long) cached->get()->size();
+        }
+
+    private:
+        std::shared_ptr<streamCache<T>> cached;
+        bool done;
+    };
+
+    template<class T>
+    stream<T>::stream(const std::vector<T> &data) {
+        this->underlyingVector = new std::vector<T>(data);
+        this->source = NULL;
+        this->predicates = new std::vector<streamOperation<bool(T)> *>();
+        this->consumed = false;
+        this->limitReached = false;
+    }
+
+    template<class T>
+    stream<T>::stream(std::vector<T> *data) {
+        this->underlyingVector = data;
+        this->source = NULL;
+        this->predicates = new std::vector<streamOperation<bool(T)> *>();
+        this->consumed = false;
+        this->limitReached = false;
+    }
+
+    template<class T>
+    stream<T>::stream(const std::deque<T> &data) {
+        this->underlyingVector = new std::vector<T>(data.begin(), data.end());
+        this->source = NULL;
+        this->predicates = new std::vector<streamOperation<bool(T)> *>();
+        this->consumed = false;
+        this->limitReached = false;
+    }
+
+    template<class T>
+    stream<T>::stream(const std::forward_list<T> &data) {
+        this->underlyingVector = new std::vector<T>(data.begin(), data.end());
+        this->source = NULL;
+        this->predicates = new std::vector<streamOperation<bool(T)> *>();
+        this->consumed = false;
+        this->limitReached = false;
+    }
+
+    template<class T>
+    stream<T>::stream(const std::list<T> &data) {
+        this->underlyingVector = new std::vector<T>(data.begin(), data.end());
+        this->source = NULL;
+        this->predicates = new std::vector<streamOperation<bool(T)> *>();
+        this->consumed = false;
+        this->limitReached = false;
+    }
+
+    template<class T>
+    stream<T>::stream(T data[], int length) {
+        this->underlyingVector = new std::vector<T>(data, data + length);
+        this->source = NULL;
+        this->predicates = new std::vector<streamOperation<bool(T)> *>();
+        this->consumed = false;
+        this->limitReached = false;
+    }
+
+    template<class T>
+    stream<T>::stream(streamSource<T> *source) {
+        this->underlyingVector = NULL;
+        this->source = source;
+        this->predicates = new std::vector<streamOperation<bool(T)> *>();
+        this->consumed = false;
+        this->limitReached = false;
+    }
+
+    template<class T>
+    stream<T> *stream<T>::filter(std::function<bool(T)> predicate) {
+        return addOperation(predicate, "filter", true);
+    }
+
+    template<class T>
+    stream<T> *stream<T>::guard(std::function<bool(T)> predicate) {
+        return addOperation(predicate, "guard", false);
+    }
+
+    template<class T>
+    stream<T> *stream<T>::addOperation(std::function<bool(T)> predicate, const char *name, bool reorderable) {
+        checkConsumed(false);
+        auto *op = new streamOperation<bool(T)>(new std::function<bool(T)>(predicate));
+        op->reorderable = reorderable;
+#ifdef STREAM_STATS
+        op->name = name;
+        op->index = predicates->size();
+#else
+        (void) name;
+#endif
+        predicates->push_back(op);
+        return this;
+    }
+
+    template<class T>
+    stream<T> *stream<T>::filter(memoizer<T, bool> *predicate) {
+        return addOperation(predicate->function(), "memoize", true);
+    }
+
+    template<class T>
+    T stream<T>::find() {
+        checkConsumed(true);
+        T result = T();
+        traverse([&result](const T &v) -> bool {
+            result = v;
+            return false;
+        });
+        return result;
+    }
+
+    template<class T>
+    bool stream<T>::anyMatches() {
+        checkConsumed(true);
+        bool found = false;
+        traverse([&found](const T &) -> bool {
+            found = true;
+            return false;
+        });
+        return found;
+    }
+
+    template<class T>
+    bool stream<T>::allMatch() {
+        checkConsumed(true);
+        bool all = true;
+        forEachElement([this, &all](const T &v) -> bool {
+            all = matches(v);
+            return all && !limitReached;
+        });
+        return all;
+    }
+
+    template<class T>
+    template<class R>
+    stream<R> *stream<T>::map(std::function<R(T)> mappingFunction) {
+        return new stream<R>(toVector(mappingFunction));
+    }
+
+    template<class T>
+    template<class R>
+    stream<R> *stream<T>::map(memoizer<T, R> *mappingFunction) {
+        return map(mappingFunction->function());
+    }
+
+    template<class T>
+    T stream<T>::reduce(std::function<T(T, T)> reductorFunction) {
+        std::vector<T> *filtered = toVector();
+        auto previousVal = filtered->front();
+        for (typename std::vector<T>::iterator it = filtered->begin() + 1; it != filtered->end(); ++it) {
+            previousVal = reductorFunction(previousVal, (*it));
+        }
+        return previousVal;
+    }
+
+    template<class T>
+    void stream<T>::foreach(std::function<void(T)> exectutionFunction) {
+        checkConsumed(true);
+        traverse([&exectutionFunction](const T &v) -> bool {
+            exectutionFunction(v);
+            return true;
+        });
+    }
+
+    template<class T>
+    std::vector<T> *stream<T>::toVector() {
+        checkConsumed(true);
+        if (predicates->empty() && underlyingVector != NULL) {
+            return new std::vector<T>(underlyingVector->begin(), underlyingVector->end());
+        }
+        std::vector<T> *result = new std::vector<T>();
+        if (predicates->empty() && knownSize() > 0) result->reserve((std::size_t) knownSize());
+        traverse([result](const T &v) -> bool {
+            result->push_back(v);
+            return true;
+        });
+        return result;
+    }
+
+    template<class T>
+    template<class R>
+    std::vector<R> *stream<T>::toVector(std::function<R(T)> mappingFunction) {
+        checkConsumed(true);
+        std::vector<R> *result = new std::vector<R>();
+        traverse([result, &mappingFunction](const T &v) -> bool {
+            result->push_back(mappingFunction(v));
+            return true;
+        });
+        return result;
+    }
+
+    template<class T>
+    std::deque<T> *stream<T>::toDeque() {
+        checkConsumed(true);
+        std::deque<T> *result = new std::deque<T>();
+        traverse([result](const T &v) -> bool {
+            result->push_back(v);
+            return true;
+        });
+        return result;
+    }
+
+    template<class T>
+    std::forward_list<T> *stream<T>::toForwardList() {
+        checkConsumed(true);
+        std::forward_list<T> *result = new std::forward_list<T>();
+        traverse([result](const T &v) -> bool {
+            result->push_front(v);
+            return true;
+        });
+        return result;
+    }
+
+    template<class T>
+    std::list<T> *stream<T>::toList() {
+        checkConsumed(true);
+        std::list<T> *result = new std::list<T>();
+        traverse([result](const T &v) -> bool {
+            result->push_back(v);
+            return true;
+        });
+        return result;
+    }
+
+    template<class T>
+    template<class C>
+    void stream<T>::collect(C &container) {
+        checkConsumed(true);
+        container.clear();
+        traverse([&container](const T &v) -> bool {
+            container.push_back(v);
+            return true;
+        });
+    }
+
+    template<class T>
+    template<class O>
+    O stream<T>::copyTo(O output) {
+        checkConsumed(true);
+        traverse([&output](const T &v) -> bool {
+            *output = v;
+            ++output;
+            return true;
+        });
+        return output;
+    }
+
+    template<class T>
+    std::vector<T> *stream<T>::topK(unsigned int k, std::function<bool(T, T)> comparator) {
+        return selectK(k, [comparator](T a, T b) -> bool { return comparator(b, a); });
+    }
+
+    template<class T>
+    std::vector<T> *stream<T>::bottomK(unsigned int k, std::function<bool(T, T)> comparator) {
+        return selectK(k, comparator);
+    }
+
+    template<class T>
+    std::vector<T> *stream<T>::selectK(unsigned int k, std::function<bool(T, T)> before) {
+        checkConsumed(true);
+        std::vector<T> *heap = new std::vector<T>();
+        if (k == 0) return heap;
+        if (knownSize() >= 0) heap->reserve(std::min<std::size_t>(k, (std::size_t) knownSize()));
+        // na szczycie kopca znajduje sie najgorszy z dotychczas wybranych elementow
+        traverse([heap, k, &before](const T &v) -> bool {
+            if (heap->size() < k) {
+                heap->push_back(v);
+                std::push_heap(heap->begin(), heap->end(), before);
+            } else if (before(v, heap->front())) {
+                std::pop_heap(heap->begin(), heap->end(), before);
+                heap->back() = v;
+                std::push_heap(heap->begin(), heap->end(), before);
+            }
+            return true;
+        });
+        std::sort_heap(heap->begin(), heap->end(), before);
+        return heap;
+    }
+
+    template<class T>
+    template<class U, class K, class R>
+    stream<R> *stream<T>::join(stream<U> *other, std::function<K(T)> leftKey, std::function<K(U)> rightKey,
+                               std::function<R(T, U)> combiner) {
+        std::vector<R> *result = new std::vector<R>();
+        // strumien o nieznanym rozmiarze traktowany jest jako wiekszy
+        unsigned long long otherSize = (unsigned long long) other->knownSize();
+        unsigned long long thisSize = (unsigned long long) knownSize();
+        if (otherSize <= thisSize) {
+            std::vector<U> *build = other->toVector();
+            checkConsumed(true);
+            hashIndex<K, U> index(build, rightKey);
+            traverse([&](const T &v) -> bool {
+                index.probe(leftKey(v), [&](const U &u) { result->push_back(combiner(v, u)); });
+                return true;
+            });
+            delete (build);
+        } else {
+            std::vector<T> *build = toVector();
+            other->checkConsumed(true);
+            hashIndex<K, T> index(build, leftKey);
+            other->traverse([&](const U &u) -> bool {
+                index.probe(rightKey(u), [&](const T &v) { result->push_back(combiner(v, u)); });
+                return true;
+            });
+            delete (build);
+        }
+        return new stream<R>(result);
+    }
+
+    template<class T>
+    stream<T> *stream<T>::sort(std::function<bool(T, T)> comparator) {
+        std::vector<T> *sorted = toVector();
+        std::stable_sort(sorted->begin(), sorted->end(), comparator);
+        return new stream<T>(sorted);
+    }
+
+    template<class T>
+    stream<T> *stream<T>::sort(std::function<bool(T, T)> comparator, std::size_t memoryBudget) {
+        checkConsumed(true);
+        externalSortSource<T> *sorted = new externalSortSource<T>(comparator, memoryBudget);
+        traverse([sorted](const T &v) -> bool {
+            sorted->add(v);
+            return true;
+        });
+        sorted->finish();
+        return new stream<T>(sorted);
+    }
+
+    template<class T>
+    template<class K>
+    stream<T> *stream<T>::semiJoin(stream<K> *keys, std::function<K(T)> keyFunction) {
+        std::shared_ptr<membershipFilter<K>> members(new membershipFilter<K>(keys->toVector()));
+        return addOperation([members, keyFunction](T v) -> bool { return members->contains(keyFunction(v)); },
+                            "semiJoin", true);
+    }
+
+    template<class T>
+    template<class K>
+    stream<T> *stream<T>::antiJoin(stream<K> *keys, std::function<K(T)> keyFunction) {
+        std::shared_ptr<membershipFilter<K>> members(new membershipFilter<K>(keys->toVector()));
+        return addOperation([members, keyFunction](T v) -> bool { return !members->contains(keyFunction(v)); },
+                            "antiJoin", true);
+    }
+
+    template<class T>
+    std::pair<std::vector<T> *, std::vector<T> *> stream<T>::partitioningBy(std::function<bool(T)> predicate) {
+        checkConsumed(true);
+        if (underlyingVector == NULL) {
+            // zrodla nie da sie przejrzec drugi raz, wiec rozmiary wynikow nie sa znane z gory
+            std::vector<T> *first = new std::vector<T>();
+            std::vector<T> *second = new std::vector<T>();
+            traverse([first, second, &predicate](const T &v) -> bool {
+                if (predicate(v)) first->push_back(v);
+                else second->push_back(v);
+                return true;
+            });
+            return std::make_pair(first, second);
+        }
+        // 0 - element odrzucony przez filter, 1 - spelnia predykat, 2 - nie spelnia predykatu
+        std::vector<unsigned char> side(underlyingVector->size());
+        std::size_t accepted = 0;
+        std::size_t rejected = 0;
+        for (std::size_t i = 0; i < underlyingVector->size() && !limitReached; ++i) {
+            T v = (*underlyingVector)[i];
+            if (!matches(v)) continue;
+            if (predicate(v)) {
+                side[i] = 1;
+                ++accepted;
+            } else {
+                side[i] = 2;
+                ++rejected;
+            }
+        }
+        std::vector<T> *first = new std::vector<T>();
+        std::vector<T> *second = new std::vector<T>();
+        first->reserve(accepted);
+        second->reserve(rejected);
+        for (std::size_t i = 0; i < underlyingVector->size(); ++i) {
+            if (side[i] == 1) first->push_back((*underlyingVector)[i]);
+            else if (side[i] == 2) second->push_back((*underlyingVector)[i]);
+        }
+        return std::make_pair(first, second);
+    }
+
+    template<class T>
+    std::vector<T> *stream<T>::sample(unsigned int k, unsigned long long seed) {
+        checkConsumed(true);
+        std::vector<T> *reservoir = new std::vector<T>();
+        if (k == 0) return reservoir;
+        if (knownSize() >= 0) reservoir->reserve(std::min<std::size_t>(k, (std::size_t) knownSize()));
+        std::mt19937_64 random(seed);
+        double w = 1.0;
+        unsigned long long skip = 0;
+        auto offer = [&](const T &v) -> bool {
+            if (reservoir->size() < k) {
+                reservoir->push_back(v);
+                if (reservoir->size() < k) return true;
+            } else if (skip > 0) {
+                --skip;
+                return true;
+            } else {
+                (*reservoir)[random() % k] = v;
+            }
+            w *= std::exp(std::log(openUnitRandom(random)) / k);
+            skip = geometricSkip(random, std::log(1.0 - w));
+            return true;
+        };
+        if (underlyingVector == NULL || !predicates->empty()) {
+            traverse(offer);
+            return reservoir;
+        }
+        // bez predykatow pominiete elementy nie musza byc nawet odczytywane
+        std::size_t size = underlyingVector->size();
+        for (std::size_t i = 0; i < size; ++i) {
+            if (reservoir->size() == k) {
+                if (size - i <= skip) break;
+                i += skip;
+                skip = 0;
+            }
+            offer((*underlyingVector)[i]);
+        }
+        return reservoir;
+    }
+
+    template<class T>
+    stream<T> *stream<T>::bernoulli(double p, unsigned long long seed) {
+        if (p >= 1.0) return this;
+        if (p <= 0.0) return addOperation([](T) -> bool { return false; }, "bernoulli", false);
+        std::shared_ptr<std::mt19937_64> random(new std::mt19937_64(seed));
+        double logFailure = std::log(1.0 - p);
+        std::shared_ptr<unsigned long long> skip(new unsigned long long(geometricSkip(*random, logFailure)));
+        addOperation([random, logFailure, skip](T) -> bool {
+            if (*skip > 0) {
+                --*skip;
+                return false;
+            }
+            *skip = geometricSkip(*random, logFailure);
+            return true;
+        }, "bernoulli", false);
+        predicates->back()->reset = [random, logFailure, skip, seed]() {
+            random->seed(seed);
+            *skip = geometricSkip(*random, logFailure);
+        };
+        return this;
+    }
 
     template<class T>
-    template<class R>
-    stream<R> *stream<T>::map(std::function<R(T)> mappingFunction) {
-        return new stream<R>(toVector(mappingFunction));
+    stream<T> *stream<T>::limit(unsigned long long n) {
+        std::shared_ptr<unsigned long long> passed(new unsigned long long(0));
+        std::shared_ptr<bool *> stopFlag(new bool *(&limitReached));
+        addOperation([stopFlag, n, passed](T) -> bool {
+            if (*passed == n) {
+                **stopFlag = true;
+                return false;
+            }
+            if (++*passed == n) **stopFlag = true;
+            return true;
+        }, "limit", false);
+        predicates->back()->stopFlag = stopFlag;
+        predicates->back()->reset = [passed]() { *passed = 0; };
+        return this;
     }
 
     template<class T>
-    T stream<T>::reduce(std::function<T(T, T)> reductorFunction) {
-        std::vector<T> *filtered = toVector();
-        auto previousVal = filtered->front();
-        for (typename std::vector<T>::iterator it = filtered->begin() + 1; it != filtered->end(); ++it) {
-            previousVal = reductorFunction(previousVal, (*it));
-        }
-        return previousVal;
+    void stream<T>::writeTo(std::ostream &out, char separator) {
+        outputBuffer buffer(out);
+        writeText(buffer, separator);
     }
 
     template<class T>
-    void stream<T>::foreach(std::function<void(T)> exectutionFunction) {
-        std::vector<T> *filtered = toVector();
-        for (typename std::vector<T>::iterator it = filtered->begin();
-             it != filtered->end();) {
-            T v = (*it);
-            exectutionFunction(v);
-            ++it;
-        }
+    void stream<T>::writeBinaryTo(std::ostream &out) {
+        outputBuffer buffer(out);
+        writeBinary(buffer);
     }
 
+#if defined(__unix__) || defined(__APPLE__)
+
     template<class T>
-    std::vector<T> *stream<T>::toVector() {
+    void stream<T>::writeTo(int descriptor, char separator) {
+        outputBuffer buffer(descriptor);
+        writeText(buffer, separator);
+    }
+
+    template<class T>
+    void stream<T>::writeBinaryTo(int descriptor) {
+        outputBuffer buffer(descriptor);
+        writeBinary(buffer);
+    }
+
+#endif
+
+    template<class T>
+    void stream<T>::writeText(outputBuffer &buffer, char separator) {
         checkConsumed(true);
-        if (predicates->empty()) {
-            return new std::vector<T>(underlyingVector->begin(), underlyingVector->end());
-        }
-        std::vector<T> *result = new std::vector<T>();
-        for (auto it = underlyingVector->begin(); it != underlyingVector->end(); ++it) {
-            bool keep = true;
-            T v = (*it);
-            for (auto oIt = predicates->begin(); oIt != predicates->end(); ++oIt) {
-                if (!(*(*oIt)->fun)(v)) {
-                    keep = false;
-                    break;
-                }
-            }
-            if (keep)
-                result->push_back(v);
-        }
-        return result;
+        traverse([&buffer, separator](const T &v) -> bool {
+            formatValue(buffer, v);
+            buffer.put(separator);
+            return true;
+        });
+        buffer.flush();
     }
 
     template<class T>
-    template<class R>
-    std::vector<R> *stream<T>::toVector(std::function<R(T)> mappingFunction) {
+    void stream<T>::writeBinary(outputBuffer &buffer) {
+        static_assert(std::is_trivially_copyable<T>::value, "binary records must be trivially copyable");
         checkConsumed(true);
-        std::vector<R> *result = new std::vector<R>();
-        for (auto it = underlyingVector->begin(); it != underlyingVector->end(); ++it) {
-            bool keep = true;
-            T v = (*it);
-            for (auto oIt = predicates->begin(); oIt != predicates->end(); ++oIt) {
-                if (!(*(*oIt)->fun)(v)) {
-                    keep = false;
-                    break;
-                }
-            }
-            if (keep)
-                result->push_back(mappingFunction(v));
-        }
-        return result;
+        traverse([&buffer](const T &v) -> bool {
+            buffer.write((const char *) &v, sizeof(T));
+            return true;
+        });
+        buffer.flush();
     }
 
+#ifdef STREAM_COROUTINES
+
     template<class T>
-    std::deque<T> *stream<T>::toDeque() {
+    template<class F>
+    auto stream<T>::async(F terminal) -> asyncResult<decltype(terminal(this))> {
+        stream<T> *self = this;
+        return asyncResult<decltype(terminal(this))>([self, terminal]() { return terminal(self); });
+    }
+
+#endif
+
+    template<class T>
+    void stream<T>::toFile(const std::string &path) {
         checkConsumed(true);
-        std::deque<T> *result = new std::deque<T>();
+        columnarFileWriter<T> writer(path);
+        traverse([&writer](const T &v) -> bool {
+            writer.add(v);
+            return true;
+        });
+        writer.close();
+    }
 
-        for (auto it = underlyingVector->begin(); it != underlyingVector->end(); ++it) {
-            bool keep = true;
-            T v = (*it);
-            for (auto oIt = predicates->begin(); oIt != predicates->end(); ++oIt) {
-                auto val = (*(*oIt)->fun)(v);;
-                if (!val) {
-                    keep = false;
-                    break;
-                }
+    template<class T>
+    stream<T> *stream<T>::peek(std::function<void(T)> observer) {
+#ifdef STREAM_NO_PEEK
+        (void) observer;
+        return this;
+#else
+        return addOperation([observer](T v) -> bool {
+            observer(v);
+            return true;
+        }, "peek", false);
+#endif
+    }
+
+    template<class T>
+    stream<T> *stream<T>::peek() {
+        return peek([](T v) { std::cout << v << " "; });
+    }
+
+    template<class T>
+    void stream<T>::checkConsumed(bool consume) {
+        if (this->consumed) throw new streamAlreadyConsumedException();
+        if (consume && cached) {
+            // strumien z zapamietanym wynikiem nie jest zuzywany przez operacje terminalne
+            this->underlyingVector = cached->get();
+            this->limitReached = false;
+            for (auto op : *predicates) {
+                if (op->reset) op->reset();
             }
-            if (keep) result->push_back(v);
+            return;
         }
-        return result;
+        this->consumed = consume;
     }
 
     template<class T>
-    std::forward_list<T> *stream<T>::toForwardList() {
-        checkConsumed(true);
-        std::forward_list<T> *result = new std::forward_list<T>();
+    stream<T> *stream<T>::cache() {
+        checkConsumed(false);
+        auto *upstream = new stream<T>((streamSource<T> *) NULL);
+        upstream->underlyingVector = underlyingVector;
+        upstream->source = source;
+        upstream->limitReached = limitReached;
+        upstream->cached = cached;
+        upstream->adaptiveSample = adaptiveSample;
+        upstream->adaptiveInterval = adaptiveInterval;
+        std::swap(upstream->predicates, predicates);
+        for (auto op : *upstream->predicates) {
+            if (op->stopFlag) *op->stopFlag = &upstream->limitReached;
+        }
+        this->underlyingVector = NULL;
+        this->source = NULL;
+        this->cached = std::make_shared<streamCache<T>>(upstream);
+        return this;
+    }
 
-        for (auto it = underlyingVector->begin(); it != underlyingVector->end(); ++it) {
-            bool keep = true;
-            T v = (*it);
-            for (auto oIt = predicates->begin(); oIt != predicates->end(); ++oIt) {
-                auto val = (*(*oIt)->fun)(v);;
-                if (!val) {
-                    keep = false;
-                    break;
-                }
+    template<class T>
+    stream<T> *stream<T>::branch() {
+        checkConsumed(false);
+        if (!cached || !predicates->empty()) cache();
+        return new stream<T>(new cacheSource<T>(cached));
+    }
+
+    template<class T>
+    bool stream<T>::matches(T v) {
+        if (adaptiveSample != 0) return matchesAdaptive(v);
+        return matchesInOrder(v);
+    }
+
+    template<class T>
+    bool stream<T>::matchesInOrder(T v) {
+#ifdef STREAM_STATS
+        for (auto oIt = predicates->begin(); oIt != predicates->end(); ++oIt) {
+            streamOperation<bool(T)> *op = *oIt;
+            bool passed;
+            if (op->in++ % STREAM_STATS_SAMPLING == 0) {
+                auto start = std::chrono::steady_clock::now();
+                passed = (*op->fun)(v);
+                auto elapsed = std::chrono::steady_clock::now() - start;
+                op->timedNanos += (unsigned long long) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        elapsed).count();
+                ++op->timedCalls;
+            } else {
+                passed = (*op->fun)(v);
             }
-            if (keep) result->push_front(v);
+            if (!passed) return false;
+            ++op->out;
         }
-        return result;
+#else
+        for (auto oIt = predicates->begin(); oIt != predicates->end(); ++oIt) {
+            if (!(*(*oIt)->fun)(v)) return false;
+        }
+#endif
+        return true;
     }
 
     template<class T>
-    std::list<T> *stream<T>::toList() {
-        checkConsumed(true);
-        std::list<T> *result = new std::list<T>();
+    bool stream<T>::matchesAdaptive(T v) {
+        unsigned long long position = adaptiveSeen++ % adaptiveInterval;
+        if (position >= adaptiveSample) return matchesInOrder(v);
+        // probkowanie w biezacej kolejnosci: filtr widzi tylko elementy przepuszczone przez poprzednie
+        bool passed = true;
+        for (auto oIt = predicates->begin(); passed && oIt != predicates->end(); ++oIt) {
+            streamOperation<bool(T)> *op = *oIt;
+#ifdef STREAM_STATS
+            ++op->in;
+#endif
+            auto start = std::chrono::steady_clock::now();
+            passed = (*op->fun)(v);
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            op->sampledNanos += (unsigned long long) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    elapsed).count();
+            ++op->sampledCalls;
+            if (passed) ++op->sampledPassed;
+#ifdef STREAM_STATS
+            if (passed) ++op->out;
+#endif
+        }
+        if (position + 1 == adaptiveSample) reorderOperations();
+        return passed;
+    }
 
-        for (auto it = underlyingVector->begin(); it != underlyingVector->end(); ++it) {
-            bool keep = true;
-            T v = (*it);
-            for (auto oIt = predicates->begin(); oIt != predicates->end(); ++oIt) {
-                if (!(*(*oIt)->fun)(v)) {
-                    keep = false;
-                    break;
-                }
+    template<class T>
+    void stream<T>::reorderOperations() {
+        auto rank = [](const streamOperation<bool(T)> *op) -> double {
+            if (op->sampledCalls == 0) return HUGE_VAL;
+            double cost = std::max(1.0, (double) op->sampledNanos / op->sampledCalls);
+            double rejected = 1.0 - (double) op->sampledPassed / op->sampledCalls;
+            return rejected <= 0.0 ? HUGE_VAL : cost / rejected;
+        };
+        auto segment = predicates->begin();
+        while (segment != predicates->end()) {
+            if (!(*segment)->reorderable) {
+                ++segment;
+                continue;
             }
-            if (keep) result->push_back(v);
+            auto segmentEnd = segment;
+            while (segmentEnd != predicates->end() && (*segmentEnd)->reorderable) ++segmentEnd;
+            std::stable_sort(segment, segmentEnd, [&rank](const streamOperation<bool(T)> *a,
+                                                          const streamOperation<bool(T)> *b) -> bool {
+                return rank(a) < rank(b);
+            });
+            segment = segmentEnd;
+        }
+        for (auto op : *predicates) {
+            op->sampledPassed = 0;
+            op->sampledCalls = 0;
+            op->sampledNanos = 0;
+        }
+    }
+
+    template<class T>
+    stream<T> *stream<T>::adaptive(unsigned int sampleSize, unsigned long long recheckInterval) {
+        checkConsumed(false);
+        this->adaptiveSample = sampleSize;
+        this->adaptiveInterval = std::max<unsigned long long>(recheckInterval, sampleSize);
+        this->adaptiveSeen = 0;
+        return this;
+    }
+
+    template<class T>
+    std::vector<stageStats> *stream<T>::stats() {
+        std::vector<stageStats> *result = new std::vector<stageStats>();
+#ifdef STREAM_STATS
+        // adaptive moze przestawic operacje, wynik zwracany jest w kolejnosci ich dodania
+        std::vector<streamOperation<bool(T)> *> ordered(*predicates);
+        std::sort(ordered.begin(), ordered.end(), [](const streamOperation<bool(T)> *a,
+                                                     const streamOperation<bool(T)> *b) -> bool {
+            return a->index < b->index;
+        });
+        for (auto op : ordered) {
+            stageStats stage;
+            stage.name = op->name;
+            stage.in = op->in;
+            stage.out = op->out;
+            stage.selectivity = op->in == 0 ? 1.0 : (double) op->out / (double) op->in;
+            stage.nanoseconds = op->timedCalls == 0 ? 0.0 : (double) op->timedNanos * op->in / op->timedCalls;
+            result->push_back(stage);
         }
+#endif
         return result;
     }
 
+    template<class T>
+    long long stream<T>::knownSize() {
+        // strumien po cache() nie ma zrodla, dopoki wynik nie zostanie wyliczony
+        if (underlyingVector == NULL && source == NULL && cached) this->underlyingVector = cached->get();
+        if (underlyingVector != NULL) return (long long) underlyingVector->size();
+        return source->size();
+    }
 
     template<class T>
-    stream<T> *stream<T>::peek() {
-        for (auto it = underlyingVector->begin(); it != underlyingVector->end(); ++it) {
-            auto keep = true;
-            T v = (*it);
-            for (auto oIt = predicates->begin(); oIt != predicates->end(); ++oIt) {
-                auto val = (*(*oIt)->fun)(v);;
-                if (!val) {
-                    keep = false;
-                    break;
-                }
+    template<class F>
+    void stream<T>::forEachElement(F consumer) {
+        if (underlyingVector != NULL) {
+            for (auto it = underlyingVector->begin(); it != underlyingVector->end(); ++it) {
+                if (!consumer(*it)) return;
+            }
+            return;
+        }
+        const T *begin;
+        const T *end;
+        while (source->nextChunk(begin, end)) {
+            for (const T *it = begin; it != end; ++it) {
+                if (!consumer(*it)) return;
             }
-            if (keep) std::cout << v << " ";
         }
-        std::cout << std::endl;
-        return this;
     }
 
     template<class T>
-    void stream<T>::checkConsumed(bool consume) {
-        if (this->consumed) throw new streamAlreadyConsumedException();
-        this->consumed = consume;
+    template<class F>
+    void stream<T>::traverse(F consumer) {
+        forEachElement([this, &consumer](const T &v) -> bool {
+            if (matches(v) && !consumer(v)) return false;
+            return !limitReached;
+        });
     }
 
     template<class T>
     stream<T>::~stream() {
-        delete (underlyingVector);
+        if (!cached) delete (underlyingVector);
+        delete (source);
         for (auto &predicate : *predicates) delete (predicate);
         delete (predicates);
     }
+
+    /**
+     * Sposob obslugi przepelnienia bufora strumienia ciaglego: producent czeka na wolne miejsce
+     * albo nowe zdarzenie jest odrzucane.
+     */
+    enum backpressurePolicy {
+        BLOCK_PRODUCER, DROP_NEWEST
+    };
+
+    /**
+     * Strumien ciagly dla nieograniczonego ciagu zdarzen. Zdarzenia publikowane metoda publish trafiaja
+     * do ograniczonej kolejki, z ktorej watek strumienia pobiera je paczkami, przepuszcza przez te same
+     * operacje (filter, peek, limit, ...) co zwykly strumien i przekazuje wynik subskrybentom.
+     * Operacje i subskrybentow nalezy dodac przed wywolaniem start. Rozmiar kolejki okresla,
+     * ile zdarzen moze czekac na przetworzenie, zanim zadziala polityka backpressurePolicy.
+     */
+    template<class T>
+    class continuousStream : public stream<T> {
+    public:
+        /**
+         * @param queue kolejka zdarzen, nie jest przejmowana na wlasnosc
+         * @param policy zachowanie metody publish przy pelnej kolejce
+         */
+        continuousStream(boundedQueue<T> *queue, backpressurePolicy policy)
+                : stream<T>(new queueSource<T>(queue)), queue(queue), policy(policy), droppedEvents(0) {
+        }
+
+        /**
+         * Dodaje funkcje wywolywana dla kazdego zdarzenia, ktore przeszlo przez operacje strumienia.
+         */
+        continuousStream<T> *subscribe(std::function<void(T)> subscriber) {
+            this->checkConsumed(false);
+            subscribers.push_back(subscriber);
+            return this;
+        }
+
+        /**
+         * Uruchamia watek przetwarzajacy zdarzenia.
+         * Operacja terminalna
+         */
+        void start() {
+            this->checkConsumed(true);
+            this->worker = std::thread([this]() {
+                this->traverse([this](const T &v) -> bool {
+                    for (auto it = subscribers.begin(); it != subscribers.end(); ++it) (*it)(v);
+                    return true;
+                });
+                // strumien zakonczony operacja limit nie przyjmuje juz zdarzen
+                queue->close();
+            });
+        }
+
+        /**
+         * Publikuje zdarzenie, mozna wywolywac z wielu watkow.
+         *
+         * @return false gdy zdarzenie zostalo odrzucone lub strumien zatrzymano
+         */
+        bool publish(const T &event) {
+            if (policy == BLOCK_PRODUCER) return queue->push(event);
+            if (queue->closed()) return false;
+            if (queue->offer(event)) return true;
+            droppedEvents.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        /**
+         * Zamyka strumien i czeka na przetworzenie zdarzen pozostalych w kolejce.
+         */
+        void stop() {
+            queue->close();
+            if (worker.joinable()) worker.join();
+        }
+
+        /**
+         * @return liczba zdarzen odrzuconych przez polityke DROP_NEWEST
+         */
+        unsigned long long dropped() const {
+            return droppedEvents.load(std::memory_order_relaxed);
+        }
+
+        ~continuousStream() {
+            stop();
+        }
+
+    private:
+        boundedQueue<T> *queue;
+        backpressurePolicy policy;
+        std::vector<std::function<void(T)>> subscribers;
+        std::thread worker;
+        std::atomic<unsigned long long> droppedEvents;
+    };
+
+    /**
+     * Domyslny typ parametrow potoku, ktory nie przyjmuje parametrow.
+     */
+    struct noParameters {
+    };
+
+    /**
+     * Potok operacji (filtrow i mapowan) budowany raz i wykonywany wielokrotnie na roznych danych.
+     * W przeciwienstwie do strumienia nie jest zuzywany przez operacje terminalna, a kolejne wykonania
+     * nie alokuja pamieci na operacje - kazdy element przechodzi przez zlozona przy budowie funkcje.
+     * Wartosci uzywane przez operacje (np. progi filtrow) moga byc przekazywane przy kazdym wykonaniu
+     * jako parametry typu P, dzieki czemu jeden potok obsluguje rozne zapytania.
+     *
+     * @tparam T typ elementow wejsciowych
+     * @tparam R typ elementow wynikowych
+     * @tparam P typ parametrow przekazywanych przy wykonaniu
+     */
+    template<class T, class R = T, class P = noParameters>
+    class pipeline {
+    public:
+        typedef std::function<bool(const T &, const P &, R &)> stepFunction;
+
+        /**
+         * Tworzy pusty potok, przepuszczajacy elementy bez zmian.
+         */
+        pipeline() {
+        }
+
+        pipeline(stepFunction step) : step(step) {
+        }
+
+        /**
+         * Dodaje do potoku filtr.
+         *
+         * @return ten sam potok
+         */
+        template<class F>
+        pipeline<T, R, P> *filter(F predicate) {
+            stepFunction previous = step;
+            this->step = [previous, predicate](const T &in, const P &parameters, R &out) -> bool {
+                return apply(previous, in, parameters, out) && predicate(out);
+            };
+            return this;
+        }
+
+        /**
+         * Dodaje do potoku filtr korzystajacy z parametrow wykonania.
+         *
+         * @return ten sam potok
+         */
+        template<class F>
+        pipeline<T, R, P> *filterWith(F predicate) {
+            stepFunction previous = step;
+            this->step = [previous, predicate](const T &in, const P &parameters, R &out) -> bool {
+                return apply(previous, in, parameters, out) && predicate(out, parameters);
+            };
+            return this;
+        }
+
+        /**
+         * Tworzy nowy potok rozszerzony o mapowanie elementow.
+         */
+        template<class U, class F>
+        pipeline<T, U, P> *map(F mappingFunction) {
+            stepFunction previous = step;
+            return new pipeline<T, U, P>([previous, mappingFunction](const T &in, const P &parameters, U &out) -> bool {
+                R intermediate;
+                if (!apply(previous, in, parameters, intermediate)) return false;
+                out = mappingFunction(intermediate);
+                return true;
+            });
+        }
+
+        /**
+         * Tworzy nowy potok rozszerzony o mapowanie elementow korzystajace z parametrow wykonania.
+         */
+        template<class U, class F>
+        pipeline<T, U, P> *mapWith(F mappingFunction) {
+            stepFunction previous = step;
+            return new pipeline<T, U, P>([previous, mappingFunction](const T &in, const P &parameters, U &out) -> bool {
+                R intermediate;
+                if (!apply(previous, in, parameters, intermediate)) return false;
+                out = mappingFunction(intermediate, parameters);
+                return true;
+            });
+        }
+
+        /**
+         * Wykonuje potok na ciaglym fragmencie danych, przekazujac wyniki do konsumenta.
+         * Konsument zwraca false aby przerwac przetwarzanie.
+         */
+        template<class F>
+        void run(const T *begin, const T *end, const P &parameters, F consumer) const {
+            R out;
+            for (const T *it = begin; it != end; ++it) {
+                if (apply(step, *it, parameters, out) && !consumer(out)) return;
+            }
+        }
+
+        template<class F>
+        void run(const T *begin, const T *end, F consumer) const {
+            run(begin, end, P(), consumer);
+        }
+
+        /**
+         * Wykonuje potok na zrodle danych, przekazujac wyniki do konsumenta.
+         * Konsument zwraca false aby przerwac przetwarzanie.
+         */
+        template<class F>
+        void run(streamSource<T> *source, const P &parameters, F consumer) const {
+            const T *begin;
+            const T *end;
+            bool proceed = true;
+            while (proceed && source->nextChunk(begin, end)) {
+                run(begin, end, parameters, [&proceed, &consumer](const R &v) -> bool {
+                    return proceed = consumer(v);
+                });
+            }
+        }
+
+        /**
+         * Wykonuje potok na wektorze, zapisujac wyniki do istniejacego kontenera. Kontener jest czyszczony,
+         * ale zachowuje zaalokowana pamiec, wiec powtarzane wykonania nie alokuja pamieci.
+         */
+        template<class C>
+        void collect(const std::vector<T> &input, const P &parameters, C &output) const {
+            output.clear();
+            run(input.data(), input.data() + input.size(), parameters, [&output](const R &v) -> bool {
+                output.push_back(v);
+                return true;
+            });
+        }
+
+        template<class C>
+        void collect(const std::vector<T> &input, C &output) const {
+            collect(input, P(), output);
+        }
+
+        /**
+         * @return liczba elementow wejscia przepuszczonych przez potok
+         */
+        std::size_t count(const std::vector<T> &input, const P &parameters = P()) const {
+            std::size_t result = 0;
+            run(input.data(), input.data() + input.size(), parameters, [&result](const R &) -> bool {
+                ++result;
+                return true;
+            });
+            return result;
+        }
+
+    private:
+        // zlozenie wszystkich operacji potoku, puste dla potoku bez operacji
+        stepFunction step;
+
+        static bool apply(const stepFunction &step, const T &in, const P &parameters, R &out) {
+            if (!step) return assign(in, out, std::is_convertible<T, R>());
+            return step(in, parameters, out);
+        }
+
+        static bool assign(const T &in, R &out, std::true_type) {
+            out = in;
+            return true;
+        }
+
+        static bool assign(const T &, R &, std::false_type) {
+            return false;
+        }
+    };
+
+    /**
+     * Widok zmaterializowany nad wektorem, do ktorego dane sa wylacznie dopisywane. Widok pamieta, ile
+     * elementow wektora juz przetworzyl, i przy odswiezeniu przepuszcza przez potok tylko nowe elementy,
+     * dopisujac wyniki do zapamietanych. Koszt odswiezenia zalezy od liczby nowych elementow, a nie od
+     * rozmiaru calych danych. Wektor nie jest kopiowany i musi istniec przez caly czas zycia widoku.
+     *
+     * @tparam T typ elementow danych
+     * @tparam R typ elementow widoku
+     */
+    template<class T, class R = T>
+    class materializedView {
+    public:
+        materializedView(const std::vector<T> *data, const pipeline<T, R> &operations)
+                : data(data), operations(operations), processed(0) {
+        }
+
+        /**
+         * Przetwarza elementy dopisane od poprzedniego odswiezenia. Gdy wektor sie skrocil (nie byl
+         * uzywany wylacznie do dopisywania), widok jest wyliczany od nowa.
+         *
+         * @return liczba elementow dodanych do widoku
+         */
+        std::size_t refresh() {
+            if (data->size() < processed) {
+                rows.clear();
+                this->processed = 0;
+            }
+            std::size_t before = rows.size();
+            std::vector<R> &target = rows;
+            operations.run(data->data() + processed, data->data() + data->size(), [&target](const R &v) -> bool {
+                target.push_back(v);
+                return true;
+            });
+            this->processed = data->size();
+            return rows.size() - before;
+        }
+
+        /**
+         * @return elementy widoku wedlug stanu z ostatniego odswiezenia
+         */
+        const std::vector<R> &result() const {
+            return rows;
+        }
+
+        /**
+         * @return strumien nad elementami widoku
+         */
+        stream<R> *toStream() const {
+            return new stream<R>(rows);
+        }
+
+    private:
+        const std::vector<T> *data;
+        pipeline<T, R> operations;
+        std::size_t processed;
+        std::vector<R> rows;
+    };
+
+    /**
+     * Agregat utrzymywany przyrostowo nad wektorem, do ktorego dane sa wylacznie dopisywane.
+     * Przy odswiezeniu nowe elementy przechodza przez potok, a wyniki sa laczone z zapamietana
+     * wartoscia agregatu, bez ponownego przegladania wczesniejszych danych.
+     *
+     * @tparam T typ elementow danych
+     * @tparam R typ elementow wynikowych potoku
+     * @tparam A typ wartosci agregatu
+     */
+    template<class T, class R, class A>
+    class materializedAggregate {
+    public:
+        materializedAggregate(const std::vector<T> *data, const pipeline<T, R> &operations, A initial,
+                              std::function<A(A, R)> combiner)
+                : data(data), operations(operations), initial(initial), aggregate(initial), combiner(combiner),
+                  processed(0) {
+        }
+
+        /**
+         * Przetwarza elementy dopisane od poprzedniego odswiezenia. Gdy wektor sie skrocil, agregat
+         * jest wyliczany od nowa.
+         *
+         * @return wartosc agregatu po odswiezeniu
+         */
+        A refresh() {
+            if (data->size() < processed) {
+                this->aggregate = initial;
+                this->processed = 0;
+            }
+            A &target = aggregate;
+            const std::function<A(A, R)> &combine = combiner;
+            operations.run(data->data() + processed, data->data() + data->size(), [&target, &combine](const R &v) -> bool {
+                target = combine(target, v);
+                return true;
+            });
+            this->processed = data->size();
+            return aggregate;
+        }
+
+        /**
+         * @return wartosc agregatu wedlug stanu z ostatniego odswiezenia
+         */
+        A value() const {
+            return aggregate;
+        }
+
+    private:
+        const std::vector<T> *data;
+        pipeline<T, R> operations;
+        A initial;
+        A aggregate;
+        std::function<A(A, R)> combiner;
+        std::size_t processed;
+    };
+}
+
+namespace std {
+    template<>
+    struct hash<stream::stringView> {
+        std::size_t operator()(const stream::stringView &text) const {
+            std::uint64_t h = 14695981039346656037ULL;
+            for (std::size_t i = 0; i < text.size(); ++i) {
+                h = (h ^ (unsigned char) text[i]) * 1099511628211ULL;
+            }
+            return (std::size_t) h;
+        }
+    };
 }
 
 #endif
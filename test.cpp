@@ -29,6 +29,20 @@ void singleMappingFunctionTest(const std::vector<int> *baseVector);
 
 void doubleMappingFunctionTest(const std::vector<int> *baseVector);
 
+void cacheTest();
+
+void adaptiveGuardTest();
+
+#ifdef STREAM_COROUTINES
+
+void coroutineSourceTest();
+
+stream::generator<int> naturals(int limit) {
+    for (int i = 0; i < limit; i++) co_yield i;
+}
+
+#endif
+
 std::vector<int> *evenOnlyNewList(std::vector<int> *vector) {
     std::vector<int> *result = new std::vector<int>();
     for (auto it = vector->begin(); it != vector->end(); ++it) {
@@ -185,7 +199,12 @@ int main() {
 //    tripleFunctionTest(baseVector);
 //    singleMappingFunctionTest(baseVector);
 //    doubleMappingFunctionTest(baseVector);
+#ifdef STREAM_COROUTINES
+//    coroutineSourceTest();
+#endif
     firstTest();
+    cacheTest();
+    adaptiveGuardTest();
     delete(baseVector);
     return 0;
 }
@@ -451,6 +470,32 @@ void doubleMappingFunctionTest(const std::vector<int> *baseVector) {
     std::cout << _7 / EXECUTIONS << std::endl;
 }
 
+#ifdef STREAM_COROUTINES
+
+void coroutineSourceTest() {
+    long long _1 = 0;
+    long long _2 = 0;
+    std::cout << "Coroutine source execution test" << std::endl;
+    std::function<bool(int)> parity = [](int a) -> bool { return (bool) (a % 2); };
+    unsigned long long allocationsBefore = stream::generator<int>::frameAllocations();
+    for (int i = 0; i < EXECUTIONS; i++) {
+        _1 += measure<>::execution([parity]() -> void {
+            stream::stream<int> *rangeCase = stream::range<int>(0, TEST_SIZE, 1);
+            delete (rangeCase->filter(parity)->toVector());
+            delete (rangeCase);
+        });
+        _2 += measure<>::execution([parity]() -> void {
+            stream::stream<int> *coroutineCase = stream::fromGenerator(naturals(TEST_SIZE));
+            delete (coroutineCase->filter(parity)->toVector());
+            delete (coroutineCase);
+        });
+    }
+    std::cout << _1 / EXECUTIONS << std::endl;
+    std::cout << _2 / EXECUTIONS << std::endl;
+    std::cout << (stream::generator<int>::frameAllocations() - allocationsBefore) / EXECUTIONS << std::endl;
+}
+
+#endif
 
 void firstTest() {
     std::vector<int> v = {1, -2, 3, -4};
@@ -468,18 +513,24 @@ void firstTest() {
     std::function<bool(int)> ff3 = [](int a) { return a >= 3; };
     std::function<double(int)> xa = [](int a) { return a + 0.1; };
 //    auto xa = [](int a) -> double { return a + 0.1; };
-    testStream
+    delete (testStream
             ->filter([](int a) { return a > 0; })
             ->filter(ff3)
-            ->peek();
-    testStream2
+            ->peek()
+            ->toVector());
+    std::cout << std::endl;
+    delete (testStream2
             ->filter(ff)
             ->map((std::function<double(int)>)([](int a) { return a + 0.1; }))
-            ->peek();
-    testStream3
+            ->peek()
+            ->toVector());
+    std::cout << std::endl;
+    delete (testStream3
             ->filter(ff)
             ->map(xa)
-            ->peek();
+            ->peek()
+            ->toVector());
+    std::cout << std::endl;
     std::string str = testStream4
                               ->filter([](int a) -> bool { return a > 0; })
                               ->filter(ff3)
@@ -493,4 +544,56 @@ void firstTest() {
                                  ->filter([](int a) -> bool { return a > 0; })
                                  ->allMatch() ? "TRUE" : "FALSE";
     std::cout << strAll << std::endl;
-}
\ No newline at end of file
+}
+
+void cacheTest() {
+    std::vector<int> v = {1, 2, 3, 4};
+    std::vector<int> w = {2, 4, 6};
+    std::function<int(int)> key = [](int a) { return a; };
+    std::function<int(int, int)> sum = [](int a, int b) { return a + b; };
+    stream::stream<int> *cached = (new stream::stream<int>(v))->filter([](int a) { return a > 1; })->cache();
+    stream::stream<int> *other = (new stream::stream<int>(w))->cache();
+    stream::stream<int> *joined = cached->join(other, key, key, sum);
+    delete (joined->peek()->toVector());
+    std::cout << std::endl;
+    delete (joined);
+    delete (other);
+    delete (cached);
+    int next = 0;
+    stream::stream<int> *limited = stream::generate<int>([&next]() { return next++; })->limit(3)->cache();
+    std::vector<int> *first = limited->toVector();
+    std::vector<int> *second = limited->toVector();
+    std::cout << first->size() << " " << second->size() << std::endl;
+    delete (first);
+    delete (second);
+    delete (limited);
+    stream::stream<int> *limitedAfter = (new stream::stream<int>(v))->cache()->limit(2);
+    first = limitedAfter->toVector();
+    second = limitedAfter->toVector();
+    std::cout << first->size() << " " << second->size() << std::endl;
+    delete (first);
+    delete (second);
+    delete (limitedAfter);
+}
+
+struct point {
+    int x;
+};
+
+void adaptiveGuardTest() {
+    std::vector<point> points(TEST_SIZE / 1000);
+    std::vector<point *> pointers;
+    for (std::size_t i = 0; i < points.size(); i++) {
+        points[i].x = (int) (i % 10) - 1;
+        // co trzeci wskaznik pusty; wyluskujacy filtr jest tanszy i bardziej selektywny niz sprawdzenie
+        pointers.push_back(i % 3 == 0 ? NULL : &points[i]);
+    }
+    stream::stream<point *> *guarded = (new stream::stream<point *>(pointers))
+            ->guard([](point *p) { return p != NULL; })
+            ->filter([](point *p) { return p->x > 7; })
+            ->adaptive(100, 1000);
+    std::vector<point *> *result = guarded->toVector();
+    std::cout << result->size() << std::endl;
+    delete (result);
+    delete (guarded);
+}